@@ -0,0 +1,127 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+// Measures the small object allocator against malloc. First a batch of mixed size allocations freed on the same thread, then the same
+// from jobs spread over every worker, and finally blocks allocated by one job and freed by another, which are mostly remote frees.
+
+#include <Benchmark.h>
+
+#include <Jobs/Manager.h>
+#include <Jobs/CounterHandle.h>
+#include <Jobs/Allocator.h>
+
+#include <vector>  // std::vector
+#include <cstdlib>  // std::malloc, std::free
+
+using namespace Jobs;
+
+namespace
+{
+	constexpr size_t batchSize = 256;  // Allocations per job.
+	constexpr size_t jobCount = 2'000;
+
+	// Sizes cycle through the smaller classes, the way job payloads and captures do.
+	constexpr size_t GetSize(size_t index)
+	{
+		return 16 + (index * 24) % 240;
+	}
+
+	struct Malloc
+	{
+		static void* Allocate(size_t size) { return std::malloc(size); }
+		static void Free(void* pointer, size_t) { std::free(pointer); }
+	};
+
+	struct SmallObject
+	{
+		static void* Allocate(size_t size) { return Jobs::Allocate(size); }
+		static void Free(void* pointer, size_t size) { Jobs::Free(pointer, size); }
+	};
+
+	template <typename Allocator>
+	void AllocateBatch(void** blocks)
+	{
+		for (size_t iter{ 0 }; iter < batchSize; ++iter)
+		{
+			blocks[iter] = Allocator::Allocate(GetSize(iter));
+			*static_cast<char*>(blocks[iter]) = 0;  // Touch it, like a real allocation would be.
+		}
+	}
+
+	template <typename Allocator>
+	void FreeBatch(void** blocks)
+	{
+		for (size_t iter{ 0 }; iter < batchSize; ++iter)
+		{
+			Allocator::Free(blocks[iter], GetSize(iter));
+		}
+	}
+
+	template <typename Allocator>
+	void SameThread(std::vector<void*>& blocks)
+	{
+		for (size_t job{ 0 }; job < jobCount; ++job)
+		{
+			AllocateBatch<Allocator>(blocks.data());
+			FreeBatch<Allocator>(blocks.data());
+		}
+	}
+
+	template <typename Allocator>
+	void InJobs(Manager& manager, std::vector<void*>& blocks)
+	{
+		auto counter{ MakeCounter() };
+
+		for (size_t job{ 0 }; job < jobCount; ++job)
+		{
+			manager.Enqueue([batch = blocks.data() + job * batchSize]
+			{
+				AllocateBatch<Allocator>(batch);
+				FreeBatch<Allocator>(batch);
+			}, counter);
+		}
+
+		counter->Wait(0);
+	}
+
+	template <typename Allocator>
+	void AcrossJobs(Manager& manager, std::vector<void*>& blocks)
+	{
+		auto allocated{ MakeCounter() };
+
+		for (size_t job{ 0 }; job < jobCount; ++job)
+		{
+			manager.Enqueue([batch = blocks.data() + job * batchSize] { AllocateBatch<Allocator>(batch); }, allocated);
+		}
+
+		allocated->Wait(0);  // Rather than a dependency per job, which would park a fiber for each.
+
+		auto freed{ MakeCounter() };
+
+		// Every batch is freed by a different job than the one that allocated it, which likely ran on another worker.
+		for (size_t job{ 0 }; job < jobCount; ++job)
+		{
+			manager.Enqueue([batch = blocks.data() + ((job + 1) % jobCount) * batchSize] { FreeBatch<Allocator>(batch); }, freed);
+		}
+
+		freed->Wait(0);
+	}
+}
+
+int main()
+{
+	Manager manager;
+	manager.Initialize();
+
+	std::vector<void*> blocks(jobCount * batchSize);
+
+	Benchmark::Measure("malloc, same thread", jobCount * batchSize, [&]() { SameThread<Malloc>(blocks); });
+	Benchmark::Measure("Allocate, same thread", jobCount * batchSize, [&]() { SameThread<SmallObject>(blocks); });
+
+	Benchmark::Measure("malloc, in jobs", jobCount * batchSize, [&]() { InJobs<Malloc>(manager, blocks); });
+	Benchmark::Measure("Allocate, in jobs", jobCount * batchSize, [&]() { InJobs<SmallObject>(manager, blocks); });
+
+	Benchmark::Measure("malloc, freed by another job", jobCount * batchSize, [&]() { AcrossJobs<Malloc>(manager, blocks); });
+	Benchmark::Measure("Allocate, freed by another job", jobCount * batchSize, [&]() { AcrossJobs<SmallObject>(manager, blocks); });
+
+	return 0;
+}
\ No newline at end of file
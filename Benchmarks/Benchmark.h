@@ -0,0 +1,38 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <chrono>  // std::chrono
+#include <cstddef>  // std::size_t
+#include <cstdio>  // std::printf
+#include <limits>  // std::numeric_limits
+#include <algorithm>  // std::min
+
+namespace Jobs::Benchmark
+{
+	constexpr size_t defaultRuns = 5;
+
+	// Runs the function once to warm up, then times it for a number of runs. The function is expected to perform the given
+	// amount of operations each call. Returns and reports the best observed time per operation in nanoseconds.
+	template <typename Function>
+	double Measure(const char* name, size_t operations, Function&& function, size_t runs = defaultRuns)
+	{
+		function();
+
+		auto best{ std::numeric_limits<double>::max() };
+
+		for (size_t run{ 0 }; run < runs; ++run)
+		{
+			const auto start{ std::chrono::steady_clock::now() };
+			function();
+			const auto end{ std::chrono::steady_clock::now() };
+
+			best = std::min(best, std::chrono::duration<double, std::nano>{ end - start }.count() / static_cast<double>(operations));
+		}
+
+		std::printf("%-48s %12.2f ns/op\n", name, best);
+		std::fflush(stdout);  // Worker shutdown can exit the process without flushing.
+
+		return best;
+	}
+}
@@ -0,0 +1,146 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+// Measures streaming values from producer jobs to consumer jobs through a Channel, individually and in bulk, against the
+// alternative of enqueueing a job per value.
+
+#include <Benchmark.h>
+
+#include <Jobs/Manager.h>
+#include <Jobs/CounterHandle.h>
+#include <Jobs/Channel.h>
+
+#include <array>  // std::array
+#include <atomic>  // std::atomic
+
+using namespace Jobs;
+
+namespace
+{
+	constexpr size_t producerCount = 4;
+	constexpr size_t consumerCount = 4;
+	constexpr size_t valuesPerProducer = 50'000;
+	constexpr size_t capacity = 256;
+	constexpr size_t bulkSize = 32;
+
+	struct Pipeline
+	{
+		Channel<size_t>* channel = nullptr;
+		std::atomic<size_t> sum{ 0 };
+		std::atomic<size_t> producersLeft{ 0 };
+	};
+
+	template <bool bulk>
+	void Stream(Manager& manager, Pipeline& pipeline)
+	{
+		auto counter{ MakeCounter() };
+
+		for (size_t iter{ 0 }; iter < consumerCount; ++iter)
+		{
+			manager.Enqueue(Job{ [](auto, void* data)
+			{
+				auto* typedPipeline{ static_cast<Pipeline*>(data) };
+				size_t sum{ 0 };
+
+				if constexpr (bulk)
+				{
+					std::array<size_t, bulkSize> values;
+
+					while (true)
+					{
+						if (const auto received{ typedPipeline->channel->TryReceiveBulk(values.begin(), values.size()) }; received > 0)
+						{
+							for (size_t index{ 0 }; index < received; ++index)
+							{
+								sum += values[index];
+							}
+
+							continue;
+						}
+
+						// Block for the next value, this is also how we learn the channel has drained.
+						const auto value{ typedPipeline->channel->Receive() };
+						if (!value)
+						{
+							break;
+						}
+
+						sum += *value;
+					}
+				}
+
+				else
+				{
+					while (const auto value{ typedPipeline->channel->Receive() })
+					{
+						sum += *value;
+					}
+				}
+
+				typedPipeline->sum.fetch_add(sum, std::memory_order_relaxed);
+			}, &pipeline }, counter);
+		}
+
+		for (size_t iter{ 0 }; iter < producerCount; ++iter)
+		{
+			manager.Enqueue(Job{ [](auto, void* data)
+			{
+				auto* typedPipeline{ static_cast<Pipeline*>(data) };
+
+				for (size_t value{ 0 }; value < valuesPerProducer; ++value)
+				{
+					typedPipeline->channel->Send(value);
+				}
+
+				if (typedPipeline->producersLeft.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					typedPipeline->channel->Close();
+				}
+			}, &pipeline }, counter);
+		}
+
+		counter->Wait(0);
+	}
+}
+
+int main()
+{
+	Manager manager;
+	manager.Initialize();
+
+	Pipeline pipeline;
+
+	Benchmark::Measure("Channel, per value", producerCount * valuesPerProducer, [&]()
+	{
+		Channel<size_t> channel{ capacity };
+		pipeline.channel = &channel;
+		pipeline.producersLeft = producerCount;
+
+		Stream<false>(manager, pipeline);
+	});
+
+	Benchmark::Measure("Channel, bulk receive", producerCount * valuesPerProducer, [&]()
+	{
+		Channel<size_t> channel{ capacity };
+		pipeline.channel = &channel;
+		pipeline.producersLeft = producerCount;
+
+		Stream<true>(manager, pipeline);
+	});
+
+	Benchmark::Measure("Job per value", producerCount * valuesPerProducer, [&]()
+	{
+		auto counter{ MakeCounter() };
+
+		for (size_t value{ 0 }; value < producerCount * valuesPerProducer; ++value)
+		{
+			manager.Enqueue(Job{ [](auto, void* data)
+			{
+				static_cast<Pipeline*>(data)->sum.fetch_add(1, std::memory_order_relaxed);
+			}, &pipeline }, counter);
+		}
+
+		counter->Wait(0);
+	});
+
+	return 0;
+}
@@ -0,0 +1,46 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+// Measures the cost of a Fiber::Schedule round trip: scheduling a fiber and having it schedule us back.
+// Build with and without the lean-context option to compare the full and lean jump routines.
+
+#include <Benchmark.h>
+
+#include <Jobs/Fiber.h>
+
+#include <cstdio>  // std::printf
+
+using namespace Jobs;
+
+namespace
+{
+	constexpr size_t roundTrips = 10'000'000;
+
+	Fiber threadFiber;  // Receives the context of the benchmark thread.
+	Fiber* pingFiber = nullptr;
+
+	void PingEntry(void*)
+	{
+		while (true)
+		{
+			threadFiber.Schedule(*pingFiber);
+		}
+	}
+}
+
+int main()
+{
+	Fiber ping{ 64 * 1024, &PingEntry, nullptr };
+	pingFiber = &ping;
+
+	std::printf("Context switch mode: %s\n", JOBS_LEAN_CONTEXT_SWITCH ? "lean (no MXCSR/x87 control word)" : "full");
+
+	Benchmark::Measure("Fiber::Schedule round trip", roundTrips, [&]()
+	{
+		for (size_t iter{ 0 }; iter < roundTrips; ++iter)
+		{
+			ping.Schedule(threadFiber);
+		}
+	});
+
+	return 0;
+}
@@ -0,0 +1,128 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+// Compares copy-stack fibers against fibers with dedicated stacks. A ring of suspended fibers schedule each other round robin,
+// every switch saves one fiber's used stack and restores the next one's in copy-stack mode. Also reports the stack memory
+// held by each suspended fiber, which is what limits the number of concurrently suspended jobs.
+
+#include <Benchmark.h>
+
+#include <Jobs/Fiber.h>
+
+#include <vector>  // std::vector
+#include <cstdio>  // std::printf, std::snprintf
+#include <cstddef>  // std::byte
+
+using namespace Jobs;
+
+namespace
+{
+	constexpr size_t ringSize = 64;
+	constexpr size_t switches = 1'000'000;
+	constexpr size_t dedicatedStackSize = 64 * 1024;  // Matches Manager::fiberStackSize.
+	constexpr size_t sharedStackSize = 256 * 1024;  // Matches Manager::sharedStackSize.
+
+	Fiber threadFiber;  // Receives the context of the benchmark thread.
+	std::vector<Fiber> ring;
+	size_t remaining = 0;
+
+	JOBS_NOINLINE void RunRing(size_t index, volatile std::byte* frame)
+	{
+		while (true)
+		{
+			frame[0] = std::byte{ 1 };  // Keep the simulated frame alive.
+
+			auto& self{ ring[index] };
+
+			if (--remaining == 0)
+			{
+				threadFiber.Schedule(self);
+			}
+
+			else
+			{
+				ring[(index + 1) % ring.size()].Schedule(self);
+			}
+		}
+	}
+
+	// Simulates a job that suspended with FrameSize bytes of its own stack in use.
+	template <size_t FrameSize>
+	void RingEntry(void*)
+	{
+		volatile std::byte frame[FrameSize];
+
+		RunRing(static_cast<size_t>(Fiber::GetCurrent() - ring.data()), frame);
+	}
+
+	template <size_t FrameSize>
+	void Run()
+	{
+		char name[64];
+
+		// Dedicated stacks.
+		{
+			ring.clear();
+			ring.reserve(ringSize);
+
+			for (size_t iter{ 0 }; iter < ringSize; ++iter)
+			{
+				ring.emplace_back(dedicatedStackSize, &RingEntry<FrameSize>, nullptr);
+			}
+
+			std::snprintf(name, sizeof(name), "Dedicated stack switch, %zu B frame", FrameSize);
+			Benchmark::Measure(name, switches, []()
+			{
+				remaining = switches;
+				ring[0].Schedule(threadFiber);
+			});
+
+			std::printf("%-48s %12zu B\n", "  Stack held per suspended fiber", dedicatedStackSize);
+		}
+
+		// Copy-stack.
+		{
+			SharedStack sharedStack{ sharedStackSize };
+
+			ring.clear();
+			ring.reserve(ringSize);
+
+			for (size_t iter{ 0 }; iter < ringSize; ++iter)
+			{
+				ring.emplace_back(&RingEntry<FrameSize>, nullptr);
+				ring.back().Bind(sharedStack);
+			}
+
+			std::snprintf(name, sizeof(name), "Copy-stack switch, %zu B frame", FrameSize);
+			Benchmark::Measure(name, switches, []()
+			{
+				remaining = switches;
+				ring[0].Schedule(threadFiber);
+			});
+
+			size_t savedTotal{ 0 };
+			size_t savedCount{ 0 };
+
+			for (const auto& fiber : ring)
+			{
+				if (fiber.GetSavedStackSize() > 0)
+				{
+					savedTotal += fiber.GetSavedStackSize();
+					++savedCount;
+				}
+			}
+
+			std::printf("%-48s %12zu B\n", "  Stack held per suspended fiber", savedCount > 0 ? savedTotal / savedCount : 0);
+
+			ring.clear();  // The fibers must not outlive the shared stack.
+		}
+	}
+}
+
+int main()
+{
+	Run<256>();
+	Run<2 * 1024>();
+	Run<8 * 1024>();
+
+	return 0;
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+// Measures the throughput of empty jobs sharing a single completion counter, which is dominated by scheduler overhead:
+// enqueue, dequeue, fiber bookkeeping, and the counter decrement on completion. Repeated with a sharded counter to show the
+// cost of contended completions. Finally, every job is tracked on its own, once with a counter per job and once with a job handle.
+
+#include <Benchmark.h>
+
+#include <Jobs/Manager.h>
+#include <Jobs/CounterHandle.h>
+#include <Jobs/JobHandle.h>
+
+#include <vector>  // std::vector
+
+
+using namespace Jobs;
+
+namespace
+{
+	constexpr size_t jobCount = 200'000;
+}
+
+int main()
+{
+	Manager manager;
+	manager.Initialize();
+
+	Benchmark::Measure("Empty job, shared counter", jobCount, [&]()
+	{
+		auto counter{ MakeCounter() };
+
+		for (size_t iter{ 0 }; iter < jobCount; ++iter)
+		{
+			manager.Enqueue(Job{ [](auto, auto) {} }, counter);
+		}
+
+		counter->Wait(0);
+	});
+
+	Benchmark::Measure("Empty job, sharded counter", jobCount, [&]()
+	{
+		auto counter{ MakeShardedCounter() };
+
+		for (size_t iter{ 0 }; iter < jobCount; ++iter)
+		{
+			manager.Enqueue(Job{ [](auto, auto) {} }, counter);
+		}
+
+		counter->Wait(0);
+	});
+
+	Benchmark::Measure("Empty job, counter per job", jobCount, [&]()
+	{
+		std::vector<CounterHandle<>> counters;
+		counters.reserve(jobCount);
+
+		for (size_t iter{ 0 }; iter < jobCount; ++iter)
+		{
+			auto& counter{ counters.emplace_back(MakeCounter()) };
+			manager.Enqueue(Job{ [](auto, auto) {} }, counter);
+		}
+
+		for (auto& counter : counters)
+		{
+			counter->Wait(0);
+		}
+	});
+
+	Benchmark::Measure("Empty job, job handle", jobCount, [&]()
+	{
+		std::vector<JobHandle> handles;
+		handles.reserve(jobCount);
+
+		for (size_t iter{ 0 }; iter < jobCount; ++iter)
+		{
+			handles.push_back(manager.EnqueueTracked(Job{ [](auto, auto) {} }));
+		}
+
+		for (auto& handle : handles)
+		{
+			handle.Wait();
+		}
+	});
+
+	return 0;
+}
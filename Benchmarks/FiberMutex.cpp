@@ -0,0 +1,116 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+// Measures a FiberMutex contended by many jobs. Reports the throughput of short critical sections, then how evenly the
+// acquisitions are spread over jobs that keep relocking for a fixed period of time. A fair mutex gives every job a similar share.
+
+#include <Benchmark.h>
+
+#include <Jobs/Manager.h>
+#include <Jobs/CounterHandle.h>
+#include <Jobs/FiberMutex.h>
+
+#include <array>  // std::array
+#include <atomic>  // std::atomic_bool
+#include <mutex>  // std::lock_guard
+#include <thread>  // std::this_thread
+#include <chrono>  // std::chrono
+#include <algorithm>  // std::minmax_element
+#include <cstdio>  // std::printf
+
+using namespace Jobs;
+
+namespace
+{
+	constexpr size_t jobCount = 64;
+	constexpr size_t locksPerJob = 2'000;
+	constexpr auto fairnessPeriod = std::chrono::milliseconds{ 250 };
+
+	struct Shared
+	{
+		FiberMutex* mutex = nullptr;
+		size_t value = 0;
+		std::atomic_bool stop{ false };
+	};
+
+	struct Payload
+	{
+		Shared* shared = nullptr;
+		size_t acquisitions = 0;
+	};
+}
+
+int main()
+{
+	Manager manager;
+	manager.Initialize();
+
+	FiberMutex mutex;
+
+	Shared shared;
+	shared.mutex = &mutex;
+
+	std::array<Payload, jobCount> payloads;
+	for (auto& payload : payloads)
+	{
+		payload.shared = &shared;
+	}
+
+	Benchmark::Measure("Contended lock/unlock", jobCount * locksPerJob, [&]()
+	{
+		auto counter{ MakeCounter() };
+
+		for (auto& payload : payloads)
+		{
+			manager.Enqueue(Job{ [](auto, void* data)
+			{
+				auto* typedPayload{ static_cast<Payload*>(data) };
+
+				for (size_t iter{ 0 }; iter < locksPerJob; ++iter)
+				{
+					std::lock_guard guard{ *typedPayload->shared->mutex };
+					++typedPayload->shared->value;
+				}
+			}, &payload }, counter);
+		}
+
+		counter->Wait(0);
+	});
+
+	// Fairness.
+	{
+		auto counter{ MakeCounter() };
+
+		for (auto& payload : payloads)
+		{
+			payload.acquisitions = 0;
+
+			manager.Enqueue(Job{ [](auto, void* data)
+			{
+				auto* typedPayload{ static_cast<Payload*>(data) };
+
+				while (!typedPayload->shared->stop.load(std::memory_order_relaxed))
+				{
+					std::lock_guard guard{ *typedPayload->shared->mutex };
+					++typedPayload->shared->value;
+					++typedPayload->acquisitions;
+				}
+			}, &payload }, counter);
+		}
+
+		std::this_thread::sleep_for(fairnessPeriod);
+		shared.stop.store(true, std::memory_order_relaxed);
+
+		counter->Wait(0);
+
+		const auto [least, most] = std::minmax_element(payloads.begin(), payloads.end(), [](const auto& left, const auto& right)
+		{
+			return left.acquisitions < right.acquisitions;
+		});
+
+		std::printf("%-48s %12zu\n", "Fairness, fewest acquisitions by a job", least->acquisitions);
+		std::printf("%-48s %12zu\n", "Fairness, most acquisitions by a job", most->acquisitions);
+		std::fflush(stdout);
+	}
+
+	return 0;
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+// Measures value-returning jobs through Async() against the same work written as a plain job writing into a payload, with a
+// counter per job. Then a chain of continuations, where each link is a job depending on the previous one.
+
+#include <Benchmark.h>
+
+#include <Jobs/Manager.h>
+#include <Jobs/CounterHandle.h>
+#include <Jobs/Future.h>
+
+#include <vector>  // std::vector
+
+using namespace Jobs;
+
+namespace
+{
+	constexpr size_t jobCount = 100'000;
+	constexpr size_t chainLength = 8;  // Links that run before their predecessor park a fiber, so chains are kept short.
+	constexpr size_t chainCount = 10'000;
+}
+
+int main()
+{
+	Manager manager;
+	manager.Initialize();
+
+	Benchmark::Measure("Job and counter per result", jobCount, [&]()
+	{
+		std::vector<size_t> results(jobCount);
+		std::vector<CounterHandle<>> counters;
+		counters.reserve(jobCount);
+
+		for (size_t iter{ 0 }; iter < jobCount; ++iter)
+		{
+			auto& counter{ counters.emplace_back(MakeCounter()) };
+			manager.Enqueue([&results, iter] { results[iter] = iter; }, counter);
+		}
+
+		for (auto& counter : counters)
+		{
+			counter->Wait(0);
+		}
+	});
+
+	Benchmark::Measure("Async per result", jobCount, [&]()
+	{
+		std::vector<Future<size_t>> futures;
+		futures.reserve(jobCount);
+
+		for (size_t iter{ 0 }; iter < jobCount; ++iter)
+		{
+			futures.push_back(manager.Async([iter] { return iter; }));
+		}
+
+		for (auto& future : futures)
+		{
+			future.Get();
+		}
+	});
+
+	Benchmark::Measure("Then chain link", chainLength * chainCount, [&]()
+	{
+		for (size_t chain{ 0 }; chain < chainCount; ++chain)
+		{
+			auto future{ manager.Async([] { return size_t{ 0 }; }) };
+
+			for (size_t link{ 1 }; link < chainLength; ++link)
+			{
+				future = future.Then([](size_t& value) { return value + 1; });
+			}
+
+			future.Get();
+		}
+	});
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,183 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+// Measures the spinlock variants against std::mutex with 1 to N threads contending on a short critical section, N being the
+// hardware thread count. Reports throughput of lock/unlock pairs, then the 99th percentile latency of an acquisition.
+
+#include <Benchmark.h>
+
+#include <Jobs/Spinlock.h>
+
+#include <atomic>  // std::atomic
+#include <mutex>  // std::mutex
+#include <thread>  // std::thread
+#include <vector>  // std::vector
+#include <chrono>  // std::chrono
+#include <algorithm>  // std::max, std::sort
+#include <cstdio>  // std::printf, std::snprintf
+
+using namespace Jobs;
+
+namespace
+{
+	constexpr size_t locksPerThread = 200'000;
+	constexpr size_t latencySamplesPerThread = 20'000;
+
+	struct SpinlockAdapter
+	{
+		static constexpr const char* name = "Spinlock";
+
+		Spinlock lock;
+
+		template <typename Function>
+		void Run(Function&& function)
+		{
+			lock.Lock();
+			function();
+			lock.Unlock();
+		}
+	};
+
+	struct TicketSpinlockAdapter
+	{
+		static constexpr const char* name = "TicketSpinlock";
+
+		TicketSpinlock lock;
+
+		template <typename Function>
+		void Run(Function&& function)
+		{
+			lock.Lock();
+			function();
+			lock.Unlock();
+		}
+	};
+
+	struct McsSpinlockAdapter
+	{
+		static constexpr const char* name = "McsSpinlock";
+
+		McsSpinlock lock;
+
+		template <typename Function>
+		void Run(Function&& function)
+		{
+			McsSpinlock::Guard guard{ lock };
+			function();
+		}
+	};
+
+	struct MutexAdapter
+	{
+		static constexpr const char* name = "std::mutex";
+
+		std::mutex lock;
+
+		template <typename Function>
+		void Run(Function&& function)
+		{
+			std::lock_guard guard{ lock };
+			function();
+		}
+	};
+
+	// Starts all of the threads at once, so that they actually contend.
+	template <typename Function>
+	void RunThreads(size_t threadCount, Function&& function)
+	{
+		std::atomic_bool go{ false };
+		std::vector<std::thread> threads;
+
+		for (size_t iter{ 0 }; iter < threadCount; ++iter)
+		{
+			threads.emplace_back([&, iter]()
+			{
+				while (!go.load(std::memory_order_acquire))
+				{
+					std::this_thread::yield();
+				}
+
+				function(iter);
+			});
+		}
+
+		go.store(true, std::memory_order_release);
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	template <typename Adapter>
+	void Measure(size_t threadCount)
+	{
+		Adapter adapter;
+		size_t value{ 0 };
+
+		char name[64];
+		std::snprintf(name, sizeof(name), "%s, %zu thread(s)", Adapter::name, threadCount);
+
+		Benchmark::Measure(name, threadCount * locksPerThread, [&]()
+		{
+			RunThreads(threadCount, [&](size_t)
+			{
+				for (size_t iter{ 0 }; iter < locksPerThread; ++iter)
+				{
+					adapter.Run([&]() { ++value; });
+				}
+			});
+		});
+
+		// Latency, from asking for the lock to holding it.
+		std::vector<std::vector<double>> samples(threadCount);
+
+		RunThreads(threadCount, [&](size_t thread)
+		{
+			auto& threadSamples{ samples[thread] };
+			threadSamples.reserve(latencySamplesPerThread);
+
+			for (size_t iter{ 0 }; iter < latencySamplesPerThread; ++iter)
+			{
+				const auto start{ std::chrono::steady_clock::now() };
+
+				adapter.Run([&]()
+				{
+					threadSamples.push_back(std::chrono::duration<double, std::nano>{ std::chrono::steady_clock::now() - start }.count());
+					++value;
+				});
+			}
+		});
+
+		std::vector<double> merged;
+		for (const auto& threadSamples : samples)
+		{
+			merged.insert(merged.end(), threadSamples.begin(), threadSamples.end());
+		}
+
+		std::sort(merged.begin(), merged.end());
+
+		std::snprintf(name, sizeof(name), "%s, %zu thread(s), p99 acquire", Adapter::name, threadCount);
+		std::printf("%-48s %12.2f ns\n", name, merged[merged.size() * 99 / 100]);
+		std::fflush(stdout);
+	}
+}
+
+int main()
+{
+	const size_t maxThreads{ std::max(std::thread::hardware_concurrency(), 1u) };
+
+	for (size_t threadCount{ 1 }; ; threadCount = std::min(threadCount * 2, maxThreads))
+	{
+		Measure<SpinlockAdapter>(threadCount);
+		Measure<TicketSpinlockAdapter>(threadCount);
+		Measure<McsSpinlockAdapter>(threadCount);
+		Measure<MutexAdapter>(threadCount);
+
+		if (threadCount == maxThreads)
+		{
+			break;
+		}
+	}
+
+	return 0;
+}
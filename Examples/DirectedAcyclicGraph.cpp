@@ -1,12 +1,11 @@
 // Copyright (c) 2019-2020 Andrew Depke
 
 #include <Jobs/Manager.h>
-#include <Jobs/Counter.h>
+#include <Jobs/CounterHandle.h>
 #include <Jobs/Logging.h>
 #include <Jobs/Profiling.h>
 
 #include <atomic>
-#include <memory>
 
 using namespace Jobs;
 using namespace std::literals::chrono_literals;
@@ -39,19 +38,19 @@ void DoWork(int workAmount)
 int main()
 {
 	// Task trackers.
-	auto counterA = std::make_shared<Counter<>>();
-	auto counterB = std::make_shared<Counter<>>();
-	auto counterC = std::make_shared<Counter<>>();
-	auto counterD = std::make_shared<Counter<>>();
-	auto counterE = std::make_shared<Counter<>>();
-	auto counterF = std::make_shared<Counter<>>();
-	auto counterG = std::make_shared<Counter<>>();
-	auto counterH = std::make_shared<Counter<>>();
-	auto counterI = std::make_shared<Counter<>>();
-	auto counterJ = std::make_shared<Counter<>>();
-	auto counterK = std::make_shared<Counter<>>();
-	auto counterL = std::make_shared<Counter<>>();
-	auto counterM = std::make_shared<Counter<>>();
+	auto counterA = MakeCounter();
+	auto counterB = MakeCounter();
+	auto counterC = MakeCounter();
+	auto counterD = MakeCounter();
+	auto counterE = MakeCounter();
+	auto counterF = MakeCounter();
+	auto counterG = MakeCounter();
+	auto counterH = MakeCounter();
+	auto counterI = MakeCounter();
+	auto counterJ = MakeCounter();
+	auto counterK = MakeCounter();
+	auto counterL = MakeCounter();
+	auto counterM = MakeCounter();
 
 	Manager manager;  // Hosts the workers, fibers, and job queue.
 	manager.Initialize();  // Default ctor creates a worker for every hardware thread.
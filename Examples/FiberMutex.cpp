@@ -1,13 +1,12 @@
 // Copyright (c) 2019-2020 Andrew Depke
 
 #include <Jobs/Manager.h>
-#include <Jobs/Counter.h>
+#include <Jobs/CounterHandle.h>
 #include <Jobs/FiberMutex.h>
 #include <Jobs/Logging.h>
 #include <Jobs/Profiling.h>
 
 #include <atomic>
-#include <memory>
 #include <mutex>
 #include <vector>
 #include <algorithm>
@@ -20,7 +19,7 @@ int main()
 {
 	std::vector<int> items;
 
-	auto counter = std::make_shared<Counter<>>();
+	auto counter = MakeCounter();
 
 	Manager manager;  // Hosts the workers, fibers, and job queue.
 	manager.Initialize();  // Default ctor creates a worker for every hardware thread.
@@ -28,7 +27,7 @@ int main()
 	// Forwards optional internal logging information for debug builds. Also handles our own logging info.
 	LogManager::Get().SetOutputDevice(std::cout);
 
-	FiberMutex mutex{ &manager };
+	FiberMutex mutex;
 
 	// Create our payload to pass to the jobs. The lifetime of this payload must exceed that of the jobs which use it.
 
@@ -4,6 +4,10 @@
 
 #include <Jobs/Manager.h>
 
+#include <vector>  // std::pmr::vector
+#include <numeric>  // std::reduce, std::transform_reduce, std::accumulate
+#include <memory_resource>  // std::pmr::memory_resource
+
 namespace Jobs
 {
 	namespace Detail
@@ -43,18 +47,37 @@ namespace Jobs
 
 		struct Empty {};
 
+		constexpr auto shardedFanIn = 1024;  // Job count from which ParallelFor tracks completion with a sharded counter.
+
+		// Working memory of the algorithms comes from the given resource, falling back to the manager's.
+		inline std::pmr::memory_resource* GetAlgorithmResource(const Manager& manager, std::pmr::memory_resource* resource)
+		{
+			return resource ? resource : manager.GetMemoryResource();
+		}
+
 		template <typename Async, typename Iterator, typename CustomData, typename Function>
-		void ParallelForInternal(Manager& manager, Iterator first, Iterator last, CustomData&& data, Function&& function)
+		void ParallelForInternal(Manager& manager, Iterator first, Iterator last, CustomData&& data, Function&& function, std::pmr::memory_resource* resource)
 		{
-			std::shared_ptr<Counter<>> dependency;
+			const auto distance = std::distance(first, last);
+
+			CounterHandle<> dependency;
 
 			if constexpr (std::is_same_v<Async, std::false_type>)
 			{
-				dependency = std::make_shared<Counter<>>(0);
+				// One job per element finishing on every worker, a wide fan-in like this is worth sharding.
+				if (distance >= shardedFanIn)
+				{
+					dependency = MakeShardedCounter();
+				}
+
+				else
+				{
+					dependency = MakeCounter();
+				}
 			}
 
-			std::vector<AlgorithmPayload<Detail::FakeContainer<Iterator>, std::remove_reference_t<CustomData>>> payloads;
-			payloads.resize(std::distance(first, last));
+			std::pmr::vector<AlgorithmPayload<Detail::FakeContainer<Iterator>, std::remove_reference_t<CustomData>>> payloads{ GetAlgorithmResource(manager, resource) };
+			payloads.resize(distance);
 			// #TODO: Maybe we don't actually need this? Look into it.
 			static_assert(std::is_trivially_copyable_v<AlgorithmPayload<Detail::FakeContainer<Iterator>, std::remove_reference_t<CustomData>>>, "AlgorithmPayload must be trivially copyable");
 
@@ -68,7 +91,7 @@ namespace Jobs
 			for (; first != last; ++first)
 			{
 				const auto index = std::distance(cachedFirst, first);
-				payloads[index].Iterator = first;
+				payloads[index].iterator = first;
 
 				if constexpr (std::is_same_v<Async, std::true_type>)
 				{
@@ -89,51 +112,51 @@ namespace Jobs
 	}
 
 	template <typename Iterator, typename CustomData, typename Function>
-	inline void ParallelFor(Manager& manager, Iterator first, Iterator last, CustomData&& data, Function&& function)
+	inline void ParallelFor(Manager& manager, Iterator first, Iterator last, CustomData&& data, Function&& function, std::pmr::memory_resource* resource = nullptr)
 	{
-		Detail::ParallelForInternal<std::false_type>(manager, first, last, std::forward<CustomData>(data), std::forward<Function>(function));
+		Detail::ParallelForInternal<std::false_type>(manager, first, last, std::forward<CustomData>(data), std::forward<Function>(function), resource);
 	}
 
 	template <typename Iterator, typename Function>
-	inline void ParallelFor(Manager& manager, Iterator first, Iterator last, Function&& function)
+	inline void ParallelFor(Manager& manager, Iterator first, Iterator last, Function&& function, std::pmr::memory_resource* resource = nullptr)
 	{
-		Detail::ParallelForInternal<std::false_type>(manager, first, last, Detail::Empty{}, std::forward<Function>(function));
+		Detail::ParallelForInternal<std::false_type>(manager, first, last, Detail::Empty{}, std::forward<Function>(function), resource);
 	}
 
 	template <typename Container, typename CustomData, typename Function>
-	inline void ParallelFor(Manager& manager, Container&& container, CustomData&& data, Function&& function)
+	inline void ParallelFor(Manager& manager, Container&& container, CustomData&& data, Function&& function, std::pmr::memory_resource* resource = nullptr)
 	{
-		Detail::ParallelForInternal<std::false_type>(manager, std::begin(container), std::end(container), std::forward<CustomData>(data), std::forward<Function>(function));
+		Detail::ParallelForInternal<std::false_type>(manager, std::begin(container), std::end(container), std::forward<CustomData>(data), std::forward<Function>(function), resource);
 	}
 
 	template <typename Container, typename Function>
-	inline void ParallelFor(Manager& manager, Container&& container, Function&& function)
+	inline void ParallelFor(Manager& manager, Container&& container, Function&& function, std::pmr::memory_resource* resource = nullptr)
 	{
-		Detail::ParallelForInternal<std::false_type>(manager, std::begin(container), std::end(container), Detail::Empty{}, std::forward<Function>(function));
+		Detail::ParallelForInternal<std::false_type>(manager, std::begin(container), std::end(container), Detail::Empty{}, std::forward<Function>(function), resource);
 	}
 
 	template <typename Iterator, typename CustomData, typename Function>
-	inline void ParallelForAsync(Manager& manager, Iterator first, Iterator last, CustomData&& data, Function&& function)
+	inline void ParallelForAsync(Manager& manager, Iterator first, Iterator last, CustomData&& data, Function&& function, std::pmr::memory_resource* resource = nullptr)
 	{
-		Detail::ParallelForInternal<std::true_type>(manager, first, last, std::forward<CustomData>(data), std::forward<Function>(function));
+		Detail::ParallelForInternal<std::true_type>(manager, first, last, std::forward<CustomData>(data), std::forward<Function>(function), resource);
 	}
 	
 	template <typename Iterator, typename Function>
-	inline void ParallelForAsync(Manager& manager, Iterator first, Iterator last, Function&& function)
+	inline void ParallelForAsync(Manager& manager, Iterator first, Iterator last, Function&& function, std::pmr::memory_resource* resource = nullptr)
 	{
-		Detail::ParallelForInternal<std::true_type>(manager, first, last, Detail::Empty{}, std::forward<Function>(function));
+		Detail::ParallelForInternal<std::true_type>(manager, first, last, Detail::Empty{}, std::forward<Function>(function), resource);
 	}
 
 	template <typename Container, typename CustomData, typename Function>
-	inline void ParallelForAsync(Manager& manager, Container&& container, CustomData&& data, Function&& function)
+	inline void ParallelForAsync(Manager& manager, Container&& container, CustomData&& data, Function&& function, std::pmr::memory_resource* resource = nullptr)
 	{
-		Detail::ParallelForInternal<std::true_type>(manager, std::begin(container), std::end(container), std::forward<CustomData>(data), std::forward<Function>(function));
+		Detail::ParallelForInternal<std::true_type>(manager, std::begin(container), std::end(container), std::forward<CustomData>(data), std::forward<Function>(function), resource);
 	}
 
 	template <typename Container, typename Function>
-	inline void ParallelForAsync(Manager& manager, Container&& container, Function&& function)
+	inline void ParallelForAsync(Manager& manager, Container&& container, Function&& function, std::pmr::memory_resource* resource = nullptr)
 	{
-		Detail::ParallelForInternal<std::true_type>(manager, std::begin(container), std::end(container), Detail::Empty{}, std::forward<Function>(function));
+		Detail::ParallelForInternal<std::true_type>(manager, std::begin(container), std::end(container), Detail::Empty{}, std::forward<Function>(function), resource);
 	}
 
 	namespace Detail
@@ -155,14 +178,14 @@ namespace Jobs
 		};
 
 		template <typename Iterator, typename UnaryOp, typename BinaryOp>
-		auto ParallelMapReduceInternal(Manager& manager, Iterator first, Iterator last, UnaryOp&& mapOperation, BinaryOp&& reduceOperation)
+		auto ParallelMapReduceInternal(Manager& manager, Iterator first, Iterator last, UnaryOp&& mapOperation, BinaryOp&& reduceOperation, std::pmr::memory_resource* resource)
 		{
 			using IntermediateType = decltype(mapOperation(*first));
 			using ResultType = decltype(reduceOperation(std::declval<IntermediateType>(), std::declval<IntermediateType>()));
-			using ResultContainerType = std::vector<ResultType>;
+			using ResultContainerType = std::pmr::vector<ResultType>;
 			using PayloadType = MapReducePayload<Iterator, std::remove_reference_t<UnaryOp>, std::remove_reference_t<BinaryOp>, decltype(std::declval<ResultContainerType>().begin())>;
 
-			auto dependency{ std::make_shared<Counter<>>(0) };
+			auto dependency{ MakeCounter() };
 
 			const auto distance = std::distance(first, last);  // Data set size.
 
@@ -184,9 +207,9 @@ namespace Jobs
 			const auto payloadSize = distance / jobCount;  // Input data chunk size per job.
 			const size_t remainder = distance % payloadSize;  // Left over data chunk for the last job.
 
-			ResultContainerType results;
+			ResultContainerType results{ GetAlgorithmResource(manager, resource) };
 			results.resize(jobCount);  // Each job produces an intermediate result.
-			std::vector<PayloadType> payloads;
+			std::pmr::vector<PayloadType> payloads{ GetAlgorithmResource(manager, resource) };
 			payloads.resize(jobCount);  // Each job needs a payload as well.
 
 			// Separate the loops in order to maintain cache locality.
@@ -209,7 +232,7 @@ namespace Jobs
 			
 			for (size_t iter{ 0 }; iter < jobCount; ++iter)
 			{
-				manager.Enqueue(Job{ [](auto payload)
+				manager.Enqueue(Job{ [](auto, auto payload)
 					{
 						auto* typedPayload = reinterpret_cast<PayloadType*>(payload);
 						
@@ -232,26 +255,26 @@ namespace Jobs
 	}
 
 	template <typename Iterator, typename UnaryOp, typename BinaryOp>
-	inline auto ParallelMapReduce(Manager& manager, Iterator first, Iterator last, UnaryOp&& mapOperation, BinaryOp&& reduceOperation)
+	inline auto ParallelMapReduce(Manager& manager, Iterator first, Iterator last, UnaryOp&& mapOperation, BinaryOp&& reduceOperation, std::pmr::memory_resource* resource = nullptr)
 	{
-		return Detail::ParallelMapReduceInternal(manager, first, last, std::forward<UnaryOp>(mapOperation), std::forward<BinaryOp>(reduceOperation));
+		return Detail::ParallelMapReduceInternal(manager, first, last, std::forward<UnaryOp>(mapOperation), std::forward<BinaryOp>(reduceOperation), resource);
 	}
 
 	template <typename Container, typename UnaryOp, typename BinaryOp>
-	inline auto ParallelMapReduce(Manager& manager, Container&& container, UnaryOp&& mapOperation, BinaryOp&& reduceOperation)
+	inline auto ParallelMapReduce(Manager& manager, Container&& container, UnaryOp&& mapOperation, BinaryOp&& reduceOperation, std::pmr::memory_resource* resource = nullptr)
 	{
-		return Detail::ParallelMapReduceInternal(manager, std::begin(container), std::end(container), std::forward<UnaryOp>(mapOperation), std::forward<BinaryOp>(reduceOperation));
+		return Detail::ParallelMapReduceInternal(manager, std::begin(container), std::end(container), std::forward<UnaryOp>(mapOperation), std::forward<BinaryOp>(reduceOperation), resource);
 	}
 
 	template <typename Iterator, typename BinaryOp>
-	inline auto ParallelReduce(Manager& manager, Iterator first, Iterator last, BinaryOp&& reduceOperation)
+	inline auto ParallelReduce(Manager& manager, Iterator first, Iterator last, BinaryOp&& reduceOperation, std::pmr::memory_resource* resource = nullptr)
 	{
-		return Detail::ParallelMapReduceInternal(manager, first, last, Detail::NoOp{}, std::forward<BinaryOp>(reduceOperation));
+		return Detail::ParallelMapReduceInternal(manager, first, last, Detail::NoOp{}, std::forward<BinaryOp>(reduceOperation), resource);
 	}
 
 	template <typename Container, typename BinaryOp>
-	inline auto ParallelReduce(Manager& manager, Container&& container, BinaryOp&& reduceOperation)
+	inline auto ParallelReduce(Manager& manager, Container&& container, BinaryOp&& reduceOperation, std::pmr::memory_resource* resource = nullptr)
 	{
-		return Detail::ParallelMapReduceInternal(manager, std::begin(container), std::end(container), Detail::NoOp{}, std::forward<BinaryOp>(reduceOperation));
+		return Detail::ParallelMapReduceInternal(manager, std::begin(container), std::end(container), Detail::NoOp{}, std::forward<BinaryOp>(reduceOperation), resource);
 	}
 }
\ No newline at end of file
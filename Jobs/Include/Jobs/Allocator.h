@@ -0,0 +1,140 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <array>  // std::array
+#include <cstddef>  // std::size_t, std::max_align_t
+#include <cstdint>  // std::uint8_t
+#include <memory_resource>  // std::pmr::memory_resource
+#include <new>  // std::align_val_t
+
+namespace Jobs
+{
+	namespace Detail
+	{
+		constexpr size_t smallObjectLimit = 1024;  // Larger allocations go straight to the global allocator.
+		constexpr size_t smallObjectAlignment = 64;  // Blocks are carved so that every class is aligned to at least this much.
+		constexpr size_t sizeClassCount = 20;
+
+		// Steps of 16 bytes up to 128 bytes, then four classes per doubling. Every class of a step is a multiple of that step, so a size
+		// rounded up to its alignment always lands on a class that keeps the alignment.
+		constexpr std::array<size_t, sizeClassCount> sizeClasses{ 16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 896, 1024 };
+
+		constexpr auto MakeSizeClassLookup()
+		{
+			std::array<std::uint8_t, smallObjectLimit / 16 + 1> result{};
+
+			size_t sizeClass{ 0 };
+			for (size_t iter{ 0 }; iter < result.size(); ++iter)
+			{
+				while (sizeClasses[sizeClass] < iter * 16)
+				{
+					++sizeClass;
+				}
+
+				result[iter] = static_cast<std::uint8_t>(sizeClass);
+			}
+
+			return result;
+		}
+
+		// Indexed by the size in steps of 16 bytes.
+		constexpr auto sizeClassLookup{ MakeSizeClassLookup() };
+
+		constexpr size_t AlignSize(size_t size, size_t alignment)
+		{
+			return (size + alignment - 1) & ~(alignment - 1);
+		}
+
+		constexpr bool IsSmallObject(size_t size, size_t alignment)
+		{
+			return alignment <= smallObjectAlignment && AlignSize(size, alignment) <= smallObjectLimit;
+		}
+
+		constexpr size_t SizeClassIndex(size_t size, size_t alignment)
+		{
+			return sizeClassLookup[(AlignSize(size, alignment) + 15) / 16];
+		}
+
+		void* AllocateSmall(size_t sizeClass);
+		void FreeSmall(void* pointer);
+	}
+
+	// Small object allocator with a cache per thread, so that every worker allocates and frees without synchronizing with the others.
+	// Blocks freed on another thread, such as by a job that resumed on a different worker, are handed back to the thread that owns them
+	// through a lock free list. Sizes up to 1 KiB with alignments up to 64 bytes are cached, anything else uses the global allocator.
+	inline void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		if (Detail::IsSmallObject(size, alignment))
+		{
+			return Detail::AllocateSmall(Detail::SizeClassIndex(size, alignment));
+		}
+
+		return ::operator new(size, std::align_val_t{ alignment });
+	}
+
+	// The size and alignment must match the allocation.
+	inline void Free(void* pointer, size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		if (Detail::IsSmallObject(size, alignment))
+		{
+			Detail::FreeSmall(pointer);
+		}
+
+		else
+		{
+			::operator delete(pointer, std::align_val_t{ alignment });
+		}
+	}
+
+	// Allocate() and Free() for standard containers. Every instance shares the same caches, so they all compare equal.
+	template <typename T>
+	class Allocator
+	{
+	public:
+		using value_type = T;
+
+		Allocator() = default;
+
+		template <typename U>
+		Allocator(const Allocator<U>&) noexcept {}
+
+		T* allocate(size_t count)
+		{
+			return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* pointer, size_t count)
+		{
+			Free(pointer, count * sizeof(T), alignof(T));
+		}
+
+		template <typename U>
+		bool operator==(const Allocator<U>&) const noexcept { return true; }
+
+		template <typename U>
+		bool operator!=(const Allocator<U>&) const noexcept { return false; }
+	};
+
+	// Allocate() and Free() as a memory resource, the default resource of every manager. Never destroyed, so that containers can still
+	// release their memory during static destruction.
+	std::pmr::memory_resource* GetSmallObjectResource();
+
+	namespace Detail
+	{
+		// Allocations of a single type, used for the library's own counters, builder trees, job extensions, callables and future states.
+		template <typename U>
+		struct SizeClassAllocator
+		{
+			static void* Allocate()
+			{
+				return Jobs::Allocate(sizeof(U), alignof(U));
+			}
+
+			static void Free(void* pointer)
+			{
+				Jobs::Free(pointer, sizeof(U), alignof(U));
+			}
+		};
+	}
+}
\ No newline at end of file
@@ -5,6 +5,18 @@
 #include <iostream>  // std::cerr
 #include <exception>  // std::terminate
 
+// Checked in every build, for limits that would otherwise corrupt memory.
+#define JOBS_VERIFY(expression, ...) \
+	do \
+	{ \
+		if (!(expression)) [[unlikely]] \
+		{ \
+			std::cerr << "Verification \"" << #expression << "\" failed in " << __FILE__ << ", line " << __LINE__ << ": " << __VA_ARGS__; \
+			std::terminate(); \
+		} \
+	} \
+	while (0)
+
 #if !NDEBUG
   #define JOBS_ASSERT(expression, ...) \
 	do \
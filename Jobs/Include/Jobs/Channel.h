@@ -0,0 +1,252 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <Jobs/Assert.h>
+#include <Jobs/Spinlock.h>
+#include <Jobs/ParkingLot.h>
+
+#include <atomic>  // std::atomic
+#include <cstddef>  // std::size_t
+#include <cstdint>  // std::uintptr_t
+#include <optional>  // std::optional
+#include <limits>  // std::numeric_limits
+#include <utility>  // std::move
+#include <vector>  // std::vector
+
+namespace Jobs
+{
+	// Bounded multi-producer multi-consumer queue for streaming values between jobs. Senders park while the channel is full and
+	// receivers park while it's empty, so pipelines get backpressure without holding up a worker. External threads block instead.
+	// Closing rejects any further sends, receivers drain what's left and then get nothing back.
+	template <typename T>
+	class Channel
+	{
+	private:
+		Spinlock lock;
+		std::vector<std::optional<T>> buffer;  // Ring, guarded by the lock.
+		size_t readIndex = 0;  // Also the parking address of receivers waiting for values.
+		size_t writeIndex = 0;  // Also the parking address of senders waiting for space.
+
+		// Only changed under the lock, but parking validates against them without it.
+		std::atomic<size_t> size{ 0 };
+		std::atomic_bool closed{ false };
+
+	public:
+		explicit Channel(size_t capacity);
+		~Channel() = default;
+
+		Channel(const Channel&) = delete;
+		Channel(Channel&&) noexcept = delete;
+
+		Channel& operator=(const Channel&) = delete;
+		Channel& operator=(Channel&&) noexcept = delete;
+
+		// Blocking operation. Returns false if the channel was closed, the value is dropped.
+		bool Send(T value);
+		bool TrySend(T& value);  // Only consumes the value on success.
+
+		// Blocking operation. Returns nothing once the channel is closed and drained.
+		std::optional<T> Receive();
+		std::optional<T> TryReceive();
+
+		// Moves up to count values into the output under a single lock. Returns the amount received.
+		template <typename OutputIterator>
+		size_t TryReceiveBulk(OutputIterator output, size_t count);
+
+		void Close();
+		bool IsClosed() const { return closed.load(std::memory_order_acquire); }
+
+		size_t GetCapacity() const { return buffer.size(); }
+
+	private:
+		static bool ShouldParkSender(const void* channel, std::uintptr_t);
+		static bool ShouldParkReceiver(const void* channel, std::uintptr_t);
+
+		void WakeSenders(size_t count);
+		void WakeReceivers(size_t count);
+
+		// Both expect the lock to be held.
+		void Push(T&& value);
+		T Pop();
+	};
+
+	template <typename T>
+	Channel<T>::Channel(size_t capacity) : buffer(capacity)
+	{
+		JOBS_ASSERT(capacity > 0, "Channel requires a non-zero capacity.");
+	}
+
+	template <typename T>
+	bool Channel<T>::Send(T value)
+	{
+		while (true)
+		{
+			if (IsClosed())
+			{
+				return false;
+			}
+
+			if (TrySend(value))
+			{
+				return true;
+			}
+
+			ParkingLot::Park(&writeIndex, &Channel::ShouldParkSender, this);
+		}
+	}
+
+	template <typename T>
+	bool Channel<T>::TrySend(T& value)
+	{
+		lock.Lock();
+
+		if (closed.load(std::memory_order_relaxed) || size.load(std::memory_order_relaxed) == buffer.size())
+		{
+			lock.Unlock();
+
+			return false;
+		}
+
+		Push(std::move(value));
+
+		lock.Unlock();
+
+		WakeReceivers(1);
+
+		return true;
+	}
+
+	template <typename T>
+	std::optional<T> Channel<T>::Receive()
+	{
+		while (true)
+		{
+			if (auto value{ TryReceive() }; value)
+			{
+				return value;
+			}
+
+			// Only give up once there's nothing left to drain.
+			if (IsClosed() && size.load(std::memory_order_acquire) == 0)
+			{
+				return std::nullopt;
+			}
+
+			ParkingLot::Park(&readIndex, &Channel::ShouldParkReceiver, this);
+		}
+	}
+
+	template <typename T>
+	std::optional<T> Channel<T>::TryReceive()
+	{
+		std::optional<T> result;
+
+		lock.Lock();
+
+		if (size.load(std::memory_order_relaxed) > 0)
+		{
+			result.emplace(Pop());
+		}
+
+		lock.Unlock();
+
+		if (result)
+		{
+			WakeSenders(1);
+		}
+
+		return result;
+	}
+
+	template <typename T>
+	template <typename OutputIterator>
+	size_t Channel<T>::TryReceiveBulk(OutputIterator output, size_t count)
+	{
+		size_t received{ 0 };
+
+		lock.Lock();
+
+		for (; received < count && size.load(std::memory_order_relaxed) > 0; ++received)
+		{
+			*output++ = Pop();
+		}
+
+		lock.Unlock();
+
+		if (received > 0)
+		{
+			WakeSenders(received);
+		}
+
+		return received;
+	}
+
+	template <typename T>
+	void Channel<T>::Close()
+	{
+		lock.Lock();
+		closed.store(true, std::memory_order_seq_cst);
+		lock.Unlock();
+
+		// Everyone re-checks, senders bail out and receivers drain.
+		WakeSenders(std::numeric_limits<size_t>::max());
+		WakeReceivers(std::numeric_limits<size_t>::max());
+	}
+
+	template <typename T>
+	bool Channel<T>::ShouldParkSender(const void* channel, std::uintptr_t)
+	{
+		auto* typedChannel{ static_cast<const Channel*>(channel) };
+
+		return !typedChannel->closed.load(std::memory_order_seq_cst) && typedChannel->size.load(std::memory_order_seq_cst) == typedChannel->buffer.size();
+	}
+
+	template <typename T>
+	bool Channel<T>::ShouldParkReceiver(const void* channel, std::uintptr_t)
+	{
+		auto* typedChannel{ static_cast<const Channel*>(channel) };
+
+		return typedChannel->size.load(std::memory_order_seq_cst) == 0 && !typedChannel->closed.load(std::memory_order_seq_cst);
+	}
+
+	template <typename T>
+	void Channel<T>::WakeSenders(size_t count)
+	{
+		if (ParkingLot::MayHaveParked(&writeIndex))
+		{
+			ParkingLot::Unpark(&writeIndex, count);
+		}
+	}
+
+	template <typename T>
+	void Channel<T>::WakeReceivers(size_t count)
+	{
+		if (ParkingLot::MayHaveParked(&readIndex))
+		{
+			ParkingLot::Unpark(&readIndex, count);
+		}
+	}
+
+	template <typename T>
+	void Channel<T>::Push(T&& value)
+	{
+		buffer[writeIndex].emplace(std::move(value));
+		writeIndex = (writeIndex + 1) % buffer.size();
+
+		// Sequentially consistent, pairs with the parking lot registration.
+		size.fetch_add(1, std::memory_order_seq_cst);
+	}
+
+	template <typename T>
+	T Channel<T>::Pop()
+	{
+		T value{ std::move(*buffer[readIndex]) };
+		buffer[readIndex].reset();
+		readIndex = (readIndex + 1) % buffer.size();
+
+		size.fetch_sub(1, std::memory_order_seq_cst);
+
+		return value;
+	}
+}
@@ -3,31 +3,141 @@
 #pragma once
 
 #include <atomic>  // std::atomic
-#include <mutex>  // std::mutex
+#include <memory>  // std::unique_ptr
+#include <thread>  // std::thread, std::this_thread
+#include <algorithm>  // std::max
+#include <functional>  // std::hash
+#include <cstdint>  // std::uintptr_t, std::uint32_t
+#include <chrono>  // std::chrono
 #include <Jobs/Fiber.h>
-#include <Jobs/Futex.h>
-#include <Jobs/FutexConditionVariable.h>
+#include <Jobs/ParkingLot.h>
+#include <Jobs/Spinlock.h>
 
 namespace Jobs
 {
+	namespace Detail
+	{
+		// Spreads the arrivals of each thread over the shards of a sharded counter. Only a placement hint, so a stale value after a fiber migrates is harmless.
+		inline size_t NextArrivalShard()
+		{
+			thread_local size_t cursor{ std::hash<std::thread::id>{}(std::this_thread::get_id()) };
+
+			return cursor++;
+		}
+
+		class MultiWait;
+		class JobSlots;
+
+		template <typename T>
+		struct FutureState;
+
+		template <typename T>
+		struct CounterAwaiter;
+
+		template <typename Function>
+		struct CallbackLink;
+
+		// Wakes a waiter blocked on several counters at once, shared by all of the counters it's linked into. The waiter parks on the epoch.
+		struct MultiWaitSignal
+		{
+			std::atomic<unsigned int> epoch{ 0 };
+		};
+
+		struct CounterLink
+		{
+			MultiWaitSignal* signal = nullptr;
+			CounterLink* next = nullptr;
+
+			// Set instead of a signal by links that act on their own, see CallbackLink. These wait for zero. The counter detaches the
+			// link once it's reached, then calls this outside of its lock, so the link belongs to the callback from then on.
+			void (*satisfied)(CounterLink& link) = nullptr;
+		};
+	}
+
+	template <typename T>
+	class CounterHandle;
+
 	template <typename T = unsigned int>
 	class Counter
 	{
+		friend class Manager;
+		friend class Detail::MultiWait;
+		friend class Detail::JobSlots;
+		template <typename> friend struct Detail::FutureState;
+		template <typename> friend struct Detail::CounterAwaiter;
+		template <typename> friend struct Detail::CallbackLink;
+		friend class CounterHandle<T>;
 		friend void ManagerFiberEntry(void*);
 
 	public:
 		using Type = T;
 
 	private:
+		// Sharded counters split the count over cache line sized slots, a job departs from the slot it arrived on.
+		// Only a slot draining touches internalValue, so waiting for zero stays a single load.
+		struct alignas(Detail::hardwareDestructiveInterference) Shard
+		{
+			std::atomic<T> value{ 0 };
+		};
+
+		// The small fields come first so that they share words, the pointers follow.
+
+		// Holds the count, or the number of non-empty shards for sharded counters.
 		std::atomic<T> internalValue;
-		Futex insideLock;  // Timed unsafe signaling for jobs.
-		FutexConditionVariable outsideLock;  // Blind spot safe signaling for non-worker threads.
+
+		// Waiters register themselves before evaluating, so that a decrement only needs to signal when someone is actually waiting.
+		// The threshold is the largest expected value ever registered, decrements above it can't satisfy anyone.
+		std::atomic<unsigned int> waiters{ 0 };
+		std::atomic<T> wakeThreshold{ 0 };
+
+		// Intrusive reference count, see CounterHandle.
+		std::atomic<unsigned int> references{ 0 };
+
+		std::uint32_t shardCount = 0;
+		Spinlock linkLock;  // Guards the links.
+
+		std::unique_ptr<Shard[]> shards;  // Null unless sharded.
+		Detail::CounterLink* links = nullptr;  // Threads and fibers waiting on several counters at once, see WaitAll() and WaitAny().
+		void (*release)(Counter*) = nullptr;  // Returns pooled counters once the last handle is gone. Null for counters owned elsewhere.
 
 		bool Evaluate(const T& expectedValue) const
 		{
-			return internalValue.load() <= expectedValue;  // #TODO: Memory order.
+			// Only zero can be read off the shard count, anything else needs the full sum.
+			if (shards && expectedValue != T{ 0 })
+			{
+				return Sum() <= expectedValue;
+			}
+
+			// Sequentially consistent to pair with the waiter registration, this also acquires the writes of the finished jobs.
+			return internalValue.load(std::memory_order_seq_cst) <= expectedValue;
 		}
 
+		// Total of a sharded counter. Not a snapshot, only exact once arrivals have stopped.
+		T Sum() const;
+
+		void RegisterWaiter(T expectedValue);
+		void UnregisterWaiter();
+
+		void Notify();
+
+		static bool ShouldPark(const void* counter, std::uintptr_t expectedValue);
+
+		// Links register as waiters, so they're signaled under the same conditions as Wait(). Unlinking returns false if the counter
+		// already detached the link, which only happens to callback links.
+		void Link(Detail::CounterLink& link, T expectedValue);
+		bool Unlink(Detail::CounterLink& link);
+
+		// Tracked increments and decrements used by the manager for enqueued jobs, the job keeps the returned shard until it departs.
+		size_t Arrive();
+		void Depart(size_t shard);
+
+		void ArriveShard(size_t shard, T amount);
+		void DepartShard(size_t shard);
+		void ReleaseShard();
+
+	protected:
+		Counter(T initialValue, size_t inShardCount);
+
 	public:
 		Counter();
 		Counter(T initialValue);
@@ -46,29 +156,45 @@ namespace Jobs
 		// Atomically fetch the current value.
 		const T Get() const;
 
-		// Blocking operation.
+		// Blocking operation. Parks the fiber inside of a job, blocks the thread anywhere else.
 		void Wait(T expectedValue);
 
 		// Blocking operation.
 		template <typename Rep, typename Period>
 		bool WaitFor(T expectedValue, const std::chrono::duration<Rep, Period>& timeout);
-
-	private:
-		// Futex based blocking, reserved for jobs. Susceptible to blind spot signaling.
-		template <typename Rep, typename Period>
-		bool UnsafeWait(T expectedValue, const std::chrono::duration<Rep, Period>& timeout);
 	};
 
+	// Every job references one, pooled counters are carved from the small object classes.
+	static_assert(sizeof(Counter<>) <= 48, "Counters should stay in the 48 byte size class.");
+
 	template <typename T>
 	Counter<T>::Counter() : internalValue(0) {}
 
 	template <typename T>
 	Counter<T>::Counter(T initialValue) : internalValue(initialValue) {}
 
+	template <typename T>
+	Counter<T>::Counter(T initialValue, size_t inShardCount) : internalValue(0), shardCount(static_cast<std::uint32_t>(inShardCount)), shards(std::make_unique<Shard[]>(inShardCount))
+	{
+		if (initialValue > T{ 0 })
+		{
+			shards[0].value.store(initialValue, std::memory_order_relaxed);
+			internalValue.store(1, std::memory_order_relaxed);
+		}
+	}
+
 	template <typename T>
 	Counter<T>& Counter<T>::operator++()
 	{
-		++internalValue;
+		if (shards)
+		{
+			ArriveShard(0, 1);
+
+			return *this;
+		}
+
+		// Increments happen before the work they track is enqueued, the enqueue provides the ordering.
+		internalValue.fetch_add(1, std::memory_order_relaxed);
 
 		// Don't notify.
 
@@ -78,15 +204,23 @@ namespace Jobs
 	template <typename T>
 	Counter<T>& Counter<T>::operator--()
 	{
-		--internalValue;
+		if (shards)
+		{
+			DepartShard(0);
 
-		// Notify waiting jobs.
-		insideLock.NotifyAll();  // We don't notify under lock since a blind spot signal isn't fatal, it will only cost us the timeout period.
+			return *this;
+		}
+
+		// Sequentially consistent with the waiter registration: either we observe the waiter, or the waiter observes our decrement.
+		const auto newValue{ internalValue.fetch_sub(1, std::memory_order_seq_cst) - 1 };
+
+		// Fast path, nobody is waiting or nobody can be satisfied yet.
+		if (waiters.load(std::memory_order_seq_cst) == 0 || newValue > wakeThreshold.load(std::memory_order_seq_cst)) [[likely]]
+		{
+			return *this;
+		}
 
-		// Notify waiting outsiders.
-		outsideLock.Lock();
-		outsideLock.NotifyAll();  // Notify under lock to prevent a blind spot signal, which can be fatal.
-		outsideLock.Unlock();
+		Notify();
 
 		return *this;
 	}
@@ -94,7 +228,14 @@ namespace Jobs
 	template <typename T>
 	Counter<T>& Counter<T>::operator+=(T target)
 	{
-		internalValue += target;
+		if (shards)
+		{
+			ArriveShard(0, target);
+
+			return *this;
+		}
+
+		internalValue.fetch_add(target, std::memory_order_relaxed);  // Same as the increment.
 
 		// Don't notify.
 
@@ -104,76 +245,257 @@ namespace Jobs
 	template <typename T>
 	const T Counter<T>::Get() const
 	{
-		return internalValue.load();  // #TODO: Memory order.
+		if (shards)
+		{
+			return Sum();
+		}
+
+		return internalValue.load(std::memory_order_acquire);
 	}
 
 	template <typename T>
-	void Counter<T>::Wait(T expectedValue)
+	T Counter<T>::Sum() const
 	{
-		outsideLock.Lock();
+		T result{ 0 };
 
-		while (!Evaluate(expectedValue))
+		for (size_t iter{ 0 }; iter < shardCount; ++iter)
 		{
-			outsideLock.Wait();
+			result += shards[iter].value.load(std::memory_order_seq_cst);
 		}
 
-		outsideLock.Unlock();
+		return result;
 	}
 
 	template <typename T>
-	template <typename Rep, typename Period>
-	bool Counter<T>::UnsafeWait(T expectedValue, const std::chrono::duration<Rep, Period>& timeout)
+	void Counter<T>::Notify()
 	{
-		// InternalCapture is the saved state of Internal at the time of sleeping. We will use this to know if it changed.
-		if (auto internalCapture{ internalValue.load() }; internalCapture != expectedValue)  // #TODO: Memory order.
+		// Waiters validate against the counter before parking, so there's no blind spot to guard against.
+		ParkingLot::UnparkAll(&internalValue);
+
+		// Notify outsiders waiting on several counters. Bumping the epoch before unparking keeps this blind spot safe as well.
+		Detail::CounterLink* satisfied{ nullptr };
+
+		linkLock.Lock();
+
+		for (auto** iter{ &links }; *iter;)
 		{
-			insideLock.Set(&internalValue);
+			auto* link{ *iter };
 
-			auto timeRemaining{ timeout };  // Used to represent the time budget of the sleep operation. Changes.
-			auto start{ std::chrono::system_clock::now() };
+			if (link->signal)
+			{
+				link->signal->epoch.fetch_add(1, std::memory_order_seq_cst);
+				ParkingLot::UnparkAll(&link->signal->epoch);
+			}
 
-			// The counter can change multiple times during our allocated timeout period, so we need to loop until we either timeout or successfully met expected value.
-			while (true)
+			// Callbacks are detached now and called once we let go of the lock, they're free to touch other counters.
+			else if (Evaluate(T{ 0 }))
 			{
-				if (insideLock.Wait(&internalCapture, timeRemaining))
-				{
-					// Value changed, did not time out. Re-evaluate and potentially try again if we have time.
+				*iter = link->next;
+				link->next = satisfied;
+				satisfied = link;
 
-					if (Evaluate(expectedValue))
-					{
-						// Success.
-						return true;
-					}
+				continue;
+			}
 
-					// Didn't meet the requirement, fall through.
-				}
+			iter = &link->next;
+		}
 
-				// Timed out.
-				else
-				{
-					break;
-				}
+		linkLock.Unlock();
 
-				// Attempt to reschedule a sleep.
-				auto remainder{ timeout - (std::chrono::system_clock::now() - start) };
-				if (remainder.count() > 0)
-				{
-					// We have time for another, prepare for the upcoming sleep.
+		// Callbacks might release the last reference to us, so we're done with ourselves before calling any.
+		for (auto* link{ satisfied }; link; link = link->next)
+		{
+			UnregisterWaiter();
+		}
+
+		while (satisfied)
+		{
+			auto* next{ satisfied->next };
+			satisfied->satisfied(*satisfied);
+
+			satisfied = next;
+		}
+	}
+
+	template <typename T>
+	void Counter<T>::Link(Detail::CounterLink& link, T expectedValue)
+	{
+		linkLock.Lock();
+		link.next = links;
+		links = &link;
+		linkLock.Unlock();
+
+		// Register after linking, a decrement that observes us is then guaranteed to find the link.
+		RegisterWaiter(expectedValue);
+	}
 
-					internalCapture = internalValue.load();  // #TODO: Memory order.
-					timeRemaining = std::chrono::round<decltype(timeRemaining)>(remainder);  // Update the time budget.
+	template <typename T>
+	bool Counter<T>::Unlink(Detail::CounterLink& link)
+	{
+		auto found{ false };
+
+		linkLock.Lock();
+
+		for (auto** iter{ &links }; *iter; iter = &(*iter)->next)
+		{
+			if (*iter == &link)
+			{
+				*iter = link.next;
+				found = true;
+
+				break;
+			}
+		}
+
+		linkLock.Unlock();
+
+		// Detached links were unregistered by whoever detached them.
+		if (found)
+		{
+			UnregisterWaiter();
+		}
+
+		return found;
+	}
+
+	template <typename T>
+	size_t Counter<T>::Arrive()
+	{
+		if (!shards)
+		{
+			operator++();
+
+			return 0;
+		}
+
+		const auto shard{ Detail::NextArrivalShard() % shardCount };
+		ArriveShard(shard, 1);
+
+		return shard;
+	}
+
+	template <typename T>
+	void Counter<T>::Depart(size_t shard)
+	{
+		if (!shards)
+		{
+			operator--();
+
+			return;
+		}
+
+		DepartShard(shard);
+	}
+
+	template <typename T>
+	void Counter<T>::ArriveShard(size_t shard, T amount)
+	{
+		auto& slot{ shards[shard].value };
+		auto current{ slot.load(std::memory_order_relaxed) };
+
+		while (true)
+		{
+			if (current > T{ 0 })
+			{
+				if (slot.compare_exchange_weak(current, current + amount, std::memory_order_release, std::memory_order_relaxed))
+				{
+					return;
 				}
+			}
 
-				else
+			else
+			{
+				// Count the shard as non-empty before anyone can depart from it, so the shard count can't reach zero while we're outstanding.
+				internalValue.fetch_add(1, std::memory_order_relaxed);
+
+				if (slot.compare_exchange_strong(current, amount, std::memory_order_release, std::memory_order_relaxed))
 				{
-					// Spent our time budget, fail out.
-					return false;
+					return;
 				}
+
+				// Lost the race to another arrival. Undoing can drop the last non-empty shard if that arrival already departed, so it goes through the same signaling.
+				ReleaseShard();
 			}
+		}
+	}
 
-			return false;
+	template <typename T>
+	void Counter<T>::DepartShard(size_t shard)
+	{
+		// Sequentially consistent for the same reason as the unsharded decrement.
+		if (shards[shard].value.fetch_sub(1, std::memory_order_seq_cst) == T{ 1 })
+		{
+			ReleaseShard();
+		}
+
+		// Waiters on a non-zero value can't be answered by the shard count, let them re-sum.
+		else if (waiters.load(std::memory_order_seq_cst) != 0 && wakeThreshold.load(std::memory_order_seq_cst) != T{ 0 }) [[unlikely]]
+		{
+			Notify();
+		}
+	}
+
+	template <typename T>
+	void Counter<T>::ReleaseShard()
+	{
+		const auto remaining{ internalValue.fetch_sub(1, std::memory_order_seq_cst) - 1 };
+
+		if (waiters.load(std::memory_order_seq_cst) == 0 || (remaining > T{ 0 } && wakeThreshold.load(std::memory_order_seq_cst) == T{ 0 })) [[likely]]
+		{
+			return;
+		}
+
+		Notify();
+	}
+
+	template <typename T>
+	void Counter<T>::RegisterWaiter(T expectedValue)
+	{
+		waiters.fetch_add(1, std::memory_order_seq_cst);
+
+		// Raise the threshold to cover us. It never drops, a stale threshold only costs us an unnecessary signal.
+		auto threshold{ wakeThreshold.load(std::memory_order_seq_cst) };
+		while (threshold < expectedValue && !wakeThreshold.compare_exchange_weak(threshold, expectedValue, std::memory_order_seq_cst));
+	}
+
+	template <typename T>
+	void Counter<T>::UnregisterWaiter()
+	{
+		waiters.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	template <typename T>
+	bool Counter<T>::ShouldPark(const void* counter, std::uintptr_t expectedValue)
+	{
+		return !static_cast<const Counter*>(counter)->Evaluate(static_cast<T>(expectedValue));
+	}
+
+	template <typename T>
+	void Counter<T>::Wait(T expectedValue)
+	{
+		if (Evaluate(expectedValue))
+		{
+			return;
+		}
+
+		RegisterWaiter(expectedValue);
+
+		// Every notify wakes all of the waiters, only some of them might be satisfied.
+		while (!Evaluate(expectedValue))
+		{
+			ParkingLot::Park(&internalValue, &Counter::ShouldPark, this, static_cast<std::uintptr_t>(expectedValue));
 		}
 
-		return true;
+		UnregisterWaiter();
 	}
+
+	// Counter spread over cache line sized shards, for wide fan-in where jobs finishing on every worker would otherwise contend on a single cache line.
+	// Usable anywhere a Counter is. Waiting for zero costs the same, waiting for any other value sums the shards.
+	template <typename T = unsigned int>
+	class ShardedCounter : public Counter<T>
+	{
+	public:
+		ShardedCounter() : ShardedCounter(T{ 0 }) {}
+		ShardedCounter(T initialValue) : Counter<T>(initialValue, std::max(std::thread::hardware_concurrency(), 1u)) {}
+	};
 }
\ No newline at end of file
@@ -0,0 +1,133 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <Jobs/Counter.h>
+#include <Jobs/Allocator.h>
+
+#include <atomic>  // std::atomic
+#include <cstddef>  // std::nullptr_t
+#include <new>  // placement new
+#include <utility>  // std::exchange, std::swap
+
+namespace Jobs
+{
+	namespace Detail
+	{
+		template <typename T>
+		using CounterPool = SizeClassAllocator<Counter<T>>;
+
+		template <typename U>
+		void ReleasePooledCounter(Counter<typename U::Type>* counter)
+		{
+			auto* typedCounter{ static_cast<U*>(counter) };
+			typedCounter->~U();
+
+			CounterPool<typename U::Type>::Free(typedCounter);
+		}
+	}
+
+	template <typename T>
+	class CounterHandle;
+
+	// Allocates a counter from the pool of the calling thread.
+	template <typename T = unsigned int>
+	CounterHandle<T> MakeCounter(typename Counter<T>::Type initialValue = T{ 0 });
+
+	// Allocates a sharded counter from the pool of the calling thread, see ShardedCounter.
+	template <typename T = unsigned int>
+	CounterHandle<T> MakeShardedCounter(typename Counter<T>::Type initialValue = T{ 0 });
+
+	// Intrusive reference to a counter, the size of a pointer. Counters made with MakeCounter() return to their pool once the last handle
+	// goes away. Enqueued jobs hold a handle until they depart, so a counter can't disappear while its jobs are running.
+	template <typename T = unsigned int>
+	class CounterHandle
+	{
+		template <typename U>
+		friend CounterHandle<U> MakeCounter(typename Counter<U>::Type);
+
+		template <typename U>
+		friend CounterHandle<U> MakeShardedCounter(typename Counter<U>::Type);
+
+	private:
+		Counter<T>* counter = nullptr;
+
+	public:
+		CounterHandle() = default;
+		CounterHandle(std::nullptr_t) {}
+
+		// References a counter owned elsewhere, which must outlive every handle and job using it. The counter is never released by us.
+		explicit CounterHandle(Counter<T>& inCounter) : counter(&inCounter)
+		{
+			counter->references.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		CounterHandle(const CounterHandle& other) : counter(other.counter)
+		{
+			if (counter)
+			{
+				counter->references.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		CounterHandle(CounterHandle&& other) noexcept : counter(std::exchange(other.counter, nullptr)) {}
+
+		~CounterHandle()
+		{
+			Reset();
+		}
+
+		CounterHandle& operator=(CounterHandle other) noexcept
+		{
+			std::swap(counter, other.counter);
+
+			return *this;
+		}
+
+		void Reset()
+		{
+			// Acquire and release so that whoever releases the counter sees every use of it.
+			if (counter && counter->references.fetch_sub(1, std::memory_order_acq_rel) == 1 && counter->release)
+			{
+				counter->release(counter);
+			}
+
+			counter = nullptr;
+		}
+
+		// Non-owning access, for the hot path. Valid as long as this handle is.
+		Counter<T>* Get() const { return counter; }
+
+		Counter<T>& operator*() const { return *counter; }
+		Counter<T>* operator->() const { return counter; }
+
+		explicit operator bool() const { return counter != nullptr; }
+
+		friend bool operator==(const CounterHandle& left, const CounterHandle& right) { return left.counter == right.counter; }
+		friend bool operator!=(const CounterHandle& left, const CounterHandle& right) { return left.counter != right.counter; }
+
+	private:
+		template <typename U>
+		static CounterHandle Allocate(T initialValue)
+		{
+			static_assert(sizeof(U) == sizeof(Counter<T>), "Counter pools are shared by every counter type, they can't add members.");
+
+			auto* allocated{ new (Detail::CounterPool<T>::Allocate()) U{ initialValue } };
+			allocated->release = &Detail::ReleasePooledCounter<U>;
+
+			return CounterHandle{ *allocated };
+		}
+	};
+
+	template <typename T>
+	CounterHandle<T> MakeCounter(typename Counter<T>::Type initialValue)
+	{
+		return CounterHandle<T>::template Allocate<Counter<T>>(initialValue);
+	}
+
+	template <typename T>
+	CounterHandle<T> MakeShardedCounter(typename Counter<T>::Type initialValue)
+	{
+		return CounterHandle<T>::template Allocate<ShardedCounter<T>>(initialValue);
+	}
+}
@@ -7,35 +7,95 @@
 
 #include <atomic>  // std::atomic_flag
 #include <cstddef>  // std::size_t
+#include <cstdint>  // std::uintptr_t
 #include <memory>  // std::shared_ptr
 #include <limits>  // std::numeric_limits
+#include <chrono>  // std::chrono
+#include <array>  // std::array
 
 namespace Jobs
 {
 	class Manager;
-	class FiberMutex;
+	class SharedStack;
+
+	template <typename T>
+	class FiberLocal;
+
+	// Intrusive node linking a parked fiber into the waiter list of the primitive it's waiting on. A fiber waits on at most one
+	// primitive at a time, so the fiber owns its node. It can't live on the stack, copy-stack fibers move their stack while parked.
+	struct FiberWaiter
+	{
+		std::atomic<FiberWaiter*> next{ nullptr };
+		size_t fiberIndex = std::numeric_limits<size_t>::max();  // Set by the manager before the node is published. Invalid for threads.
+
+		// Parking lot bookkeeping, see ParkingLot.
+		Manager* owner = nullptr;  // Manager of a parked fiber, null for threads.
+		const void* address = nullptr;
+		bool (*validate)(const void*, std::uintptr_t) = nullptr;
+		const void* context = nullptr;
+
+		std::uintptr_t value = 0;  // Per wait data for the primitive on the way in, the waker's token on the way out.
+		std::atomic<unsigned int> signaled{ 0 };  // Set by the waker. Threads sleep on it, fibers use it to tell a wake up from an immediate resume.
+
+		void (*resume)(FiberWaiter&) = nullptr;  // Only for waiters that block nobody, such as suspended tasks. Called by the waker instead.
+	};
 
 	class Fiber
 	{
 		friend void ManagerFiberEntry(void*);
+		friend class SharedStack;
+
+		template <typename T>
+		friend class FiberLocal;
 
 		using EntryType = void(*)(void*);
 
+		static constexpr size_t localStorageSlots = 16;
+
+		struct LocalSlot
+		{
+			void* value = nullptr;
+			void (*destructor)(void*) = nullptr;
+		};
+
 	private:
 		void* context = nullptr;
 		void* stack = nullptr;
+		size_t stackSize = 0;
 		void* data = nullptr;
+		EntryType entry = nullptr;
+
+		// Copy-stack fibers have no stack of their own, they execute on the shared stack they're bound to and keep a copy of
+		// the used portion while another fiber occupies it.
+		bool copyStack = false;
+		SharedStack* sharedStack = nullptr;
+		std::byte* savedStack = nullptr;
+		size_t savedStackSize = 0;
+		size_t savedStackCapacity = 0;
+
+		std::array<LocalSlot, localStorageSlots> localStorage{};  // Backing storage for FiberLocal, indexed by slot.
 
 	public:
 		bool waitPoolPriority = false;  // Used for alternating wait pool. Does not need to be atomic.
 		size_t previousFiberIndex = std::numeric_limits<size_t>::max();  // Used to track the fiber that scheduled us.
 		bool needsWaitEnqueue = false;  // Used to mark if we need to have availability restored or added to the wait pool.
 
-		FiberMutex* mutex = nullptr;  // Used to determine if we're waiting on a mutex.
+		// Set while parking. The next fiber calls publish with our waiter once we've been switched out, see Manager::Park().
+		bool (*parkPublish)(void*, FiberWaiter&) = nullptr;
+		void* parkContext = nullptr;
+		FiberWaiter waiter;
+
+		bool pinned = false;  // Set while executing a pinned job, we must always resume on the worker that we suspended on.
+		size_t homeWorker = std::numeric_limits<size_t>::max();  // Worker we last suspended on, which owns our entry in its ready queue.
+
+		std::chrono::steady_clock::time_point idleSince{};  // Time at which availability was last restored, used for stack trimming.
+		bool decommitted = false;  // Set once the unused stack pages have been released, cleared when the fiber is scheduled again.
+		std::atomic_bool trimming{ false };  // Set while the manager releases the stack pages, see Manager::TrimFibers(). Never swapped.
 
 	public:
 		Fiber() = default;
 		Fiber(size_t stackSize, EntryType entry, Manager* owner);
+		Fiber(EntryType entry, Manager* owner);  // Copy-stack fiber, must be bound to a SharedStack before it's scheduled.
 		Fiber(const Fiber&) = delete;
 		Fiber(Fiber&& other) noexcept;
 		~Fiber();
@@ -45,6 +105,65 @@ namespace Jobs
 
 		void Schedule(Fiber& from);
 
+		// Releases the physical pages of the stack that lie below the saved context back to the OS. The fiber must not be running.
+		void Decommit();
+
+		bool IsCopyStack() const { return copyStack; }
+		bool IsBound() const { return sharedStack != nullptr; }
+		size_t GetSavedStackSize() const { return savedStackSize; }
+
+		// Copy-stack fibers only. The frames of a suspended fiber hold pointers into the stack it ran on, so once bound it can only
+		// ever be resumed on that stack, which is owned by a single worker.
+		void Bind(SharedStack& inStack);
+
+		// Copy-stack fibers only. Discards the saved frames and unbinds, the next schedule starts over from the entry point.
+		void Reset();
+
 		void Swap(Fiber& other) noexcept;
+
+		// Returns the fiber executing on the calling thread, or nullptr if the thread never entered a fiber. Always call this
+		// again after a suspension point, the result is only valid for the thread it was retrieved on.
+		static Fiber* GetCurrent();
+
+	private:
+		static size_t AllocateLocalSlot();
+
+		void SaveStack();
+		void RestoreStack();
+	};
+
+	// Execution stack shared by the copy-stack fibers of a single worker. Only the occupant has live frames on the stack, the
+	// occupant is lazily copied out when a different fiber needs the stack. Since a fiber can't overwrite the stack it's running
+	// on, switches between two fibers on the same stack are routed through a switcher fiber that runs on a small stack of its own.
+	class SharedStack
+	{
+		friend class Fiber;
+
+		static constexpr size_t switcherStackSize = 16 * 1024;  // 16 kB
+
+	private:
+		void* stack = nullptr;
+		size_t stackSize = 0;
+
+		Fiber* occupant = nullptr;  // Fiber whose frames currently live on the stack.
+
+		Fiber switcher;
+		Fiber* switchTarget = nullptr;  // Fiber the switcher needs to move onto the stack next.
+
+	public:
+		SharedStack(size_t inStackSize);
+		SharedStack(const SharedStack&) = delete;
+		SharedStack(SharedStack&&) noexcept = delete;
+		~SharedStack();
+
+		SharedStack& operator=(const SharedStack&) = delete;
+		SharedStack& operator=(SharedStack&&) noexcept = delete;
+
+	private:
+		void* GetTop() const { return static_cast<std::byte*>(stack) + stackSize; }
+
+		void Occupy(Fiber& target);  // Saves the current occupant and restores the target. Must not be called from the shared stack.
+
+		static void SwitcherEntry(void* data);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <atomic>  // std::atomic
+#include <cstddef>  // std::ptrdiff_t, std::size_t
+#include <cstdint>  // std::uintptr_t
+
+namespace Jobs
+{
+	// Fiber-safe reusable barrier for phase synchronous work. Follows std::barrier, without a completion function.
+	// Jobs that wait park their fiber, external threads block. The last arrival of a phase releases everyone and starts the next phase.
+	class FiberBarrier
+	{
+	private:
+		std::atomic<std::ptrdiff_t> expected;  // Participants of the next phase.
+		std::atomic<std::ptrdiff_t> remaining;  // Arrivals still missing from the current phase.
+		std::atomic<size_t> phase{ 0 };  // Also the parking address.
+
+	public:
+		explicit FiberBarrier(std::ptrdiff_t inExpected) : expected(inExpected), remaining(inExpected) {}
+		~FiberBarrier() = default;
+
+		FiberBarrier(const FiberBarrier&) = delete;
+		FiberBarrier(FiberBarrier&&) noexcept = delete;
+
+		FiberBarrier& operator=(const FiberBarrier&) = delete;
+		FiberBarrier& operator=(FiberBarrier&&) noexcept = delete;
+
+		// Returns the phase, pass it to wait().
+		[[nodiscard]] size_t arrive(std::ptrdiff_t update = 1);
+		void wait(size_t arrivalPhase);
+		void arrive_and_wait();
+		void arrive_and_drop();  // Arrives, and no longer participates in any of the following phases.
+
+	private:
+		static bool ShouldPark(const void* barrier, std::uintptr_t arrivalPhase);
+	};
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <Jobs/FiberMutex.h>
+
+#include <atomic>  // std::atomic
+#include <cstdint>  // std::uintptr_t
+#include <mutex>  // std::unique_lock
+
+namespace Jobs
+{
+	// Fiber-safe condition variable, used together with FiberMutex. Follows std::condition_variable.
+	// Waiting releases the mutex and parks the fiber, the mutex is reacquired once woken. Wake ups can be spurious, prefer the predicate overload.
+	class FiberConditionVariable
+	{
+	private:
+		// Bumped by every notify, also the parking address. Waiters sample it while still holding the mutex, a notify that lands
+		// between the unlock and the waiter being parked changes it, so the waiter returns instead of sleeping through it.
+		std::atomic<std::uintptr_t> epoch{ 0 };
+
+	public:
+		FiberConditionVariable() = default;
+		~FiberConditionVariable() = default;
+
+		FiberConditionVariable(const FiberConditionVariable&) = delete;
+		FiberConditionVariable(FiberConditionVariable&&) noexcept = delete;
+
+		FiberConditionVariable& operator=(const FiberConditionVariable&) = delete;
+		FiberConditionVariable& operator=(FiberConditionVariable&&) noexcept = delete;
+
+		void wait(std::unique_lock<FiberMutex>& lock);
+		template <typename Predicate>
+		void wait(std::unique_lock<FiberMutex>& lock, Predicate predicate);
+
+		void notify_one();
+		void notify_all();
+
+	private:
+		static bool ShouldPark(const void* conditionVariable, std::uintptr_t waitEpoch);
+	};
+
+	template <typename Predicate>
+	void FiberConditionVariable::wait(std::unique_lock<FiberMutex>& lock, Predicate predicate)
+	{
+		while (!predicate())
+		{
+			wait(lock);
+		}
+	}
+}
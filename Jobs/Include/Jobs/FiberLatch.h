@@ -0,0 +1,36 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <atomic>  // std::atomic
+#include <cstddef>  // std::ptrdiff_t
+#include <cstdint>  // std::uintptr_t
+
+namespace Jobs
+{
+	// Fiber-safe single use barrier. Follows std::latch.
+	// Jobs that wait park their fiber, external threads block.
+	class FiberLatch
+	{
+	private:
+		std::atomic<std::ptrdiff_t> count;  // Also the parking address.
+
+	public:
+		explicit FiberLatch(std::ptrdiff_t expected) : count(expected) {}
+		~FiberLatch() = default;
+
+		FiberLatch(const FiberLatch&) = delete;
+		FiberLatch(FiberLatch&&) noexcept = delete;
+
+		FiberLatch& operator=(const FiberLatch&) = delete;
+		FiberLatch& operator=(FiberLatch&&) noexcept = delete;
+
+		void count_down(std::ptrdiff_t update = 1);
+		bool try_wait() const;
+		void wait();
+		void arrive_and_wait(std::ptrdiff_t update = 1);
+
+	private:
+		static bool ShouldPark(const void* latch, std::uintptr_t);
+	};
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <Jobs/Fiber.h>
+#include <Jobs/Assert.h>
+
+#include <cstddef>  // std::size_t
+
+namespace Jobs
+{
+	// Storage local to the fiber a job is executing on. Unlike thread_local, the value follows the job when it is suspended
+	// and resumed on a different worker, for example after a FiberMutex::lock() or a dependency wait.
+	// Values are lazily default constructed on first access, persist across jobs executed by the same fiber, and are destroyed
+	// along with the fiber. Slots are never recycled, so instances are expected to be long lived (static or global).
+	// At most 16 instances can exist over the lifetime of the program, see Fiber::localStorageSlots. Constructing one more terminates.
+	template <typename T>
+	class FiberLocal
+	{
+	private:
+		size_t slot;
+
+	public:
+		FiberLocal() : slot(Fiber::AllocateLocalSlot()) {}
+		FiberLocal(const FiberLocal&) = delete;
+		FiberLocal(FiberLocal&&) noexcept = delete;
+
+		FiberLocal& operator=(const FiberLocal&) = delete;
+		FiberLocal& operator=(FiberLocal&&) noexcept = delete;
+
+		// The reference stays valid across suspension points, a job never leaves the fiber it started on.
+		T& Get();
+
+		T& operator*() { return Get(); }
+		T* operator->() { return &Get(); }
+	};
+
+	template <typename T>
+	T& FiberLocal<T>::Get()
+	{
+		auto* fiber{ Fiber::GetCurrent() };
+		JOBS_ASSERT(fiber, "FiberLocal accessed outside of a fiber.");
+
+		auto& entry{ fiber->localStorage[slot] };
+
+		if (!entry.value) [[unlikely]]
+		{
+			entry.value = new T{};
+			entry.destructor = [](void* value) { delete static_cast<T*>(value); };
+		}
+
+		return *static_cast<T*>(entry.value);
+	}
+}
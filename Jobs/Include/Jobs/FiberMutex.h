@@ -2,22 +2,37 @@
 
 #pragma once
 
-#include <atomic>
+#include <atomic>  // std::atomic
+#include <cstdint>  // std::uintptr_t
 
 namespace Jobs
 {
-	class Manager;
+	namespace Detail
+	{
+		struct MutexAwaiter;
+	}
 
 	// Fiber-safe mutex, prevents deadlocking of the underlying worker.
 	// Satisfies named requirements of Lockable.
+	// Contended lockers spin briefly, then park on the mutex's word in the ParkingLot. Unlocking hands ownership directly to the oldest waiter.
+	// Usable outside of jobs as well, threads block instead.
 	class FiberMutex
 	{
+		friend struct Detail::MutexAwaiter;
+
+		static constexpr unsigned int maxSpin = 128;  // Fast path retries before parking.
+
+		static constexpr unsigned int locked = 1;
+		static constexpr unsigned int parked = 2;  // Someone might be parked, unlocking has to go through the parking lot.
+
+		static constexpr std::uintptr_t handOffToken = 1;
+
 	private:
-		Manager* owner = nullptr;
-		std::atomic_flag flag = ATOMIC_FLAG_INIT;
+		// Ownership is only ever handed over while someone is parked, so the mutex never reads as unlocked in between.
+		std::atomic<unsigned int> state{ 0 };
 
 	public:
-		FiberMutex(Manager* inOwner) : owner(inOwner) {}
+		FiberMutex() = default;
 		~FiberMutex() = default;
 
 		FiberMutex(const FiberMutex&) = delete;
@@ -29,5 +44,11 @@ namespace Jobs
 		void lock();
 		bool try_lock();
 		void unlock();
+
+	private:
+		void LockSlow();
+
+		static bool ShouldPark(const void* mutex, std::uintptr_t);
+		static std::uintptr_t HandOff(void* mutex, bool unparked, bool mayHaveMore);
 	};
-}
\ No newline at end of file
+}
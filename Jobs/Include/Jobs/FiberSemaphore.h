@@ -0,0 +1,35 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <atomic>  // std::atomic
+#include <cstddef>  // std::ptrdiff_t
+#include <cstdint>  // std::uintptr_t
+
+namespace Jobs
+{
+	// Fiber-safe counting semaphore, bounds concurrent use of a resource. Follows std::counting_semaphore.
+	// Jobs that can't acquire park their fiber, external threads block.
+	class FiberSemaphore
+	{
+	private:
+		std::atomic<std::ptrdiff_t> count;  // Also the parking address.
+
+	public:
+		explicit FiberSemaphore(std::ptrdiff_t initial) : count(initial) {}
+		~FiberSemaphore() = default;
+
+		FiberSemaphore(const FiberSemaphore&) = delete;
+		FiberSemaphore(FiberSemaphore&&) noexcept = delete;
+
+		FiberSemaphore& operator=(const FiberSemaphore&) = delete;
+		FiberSemaphore& operator=(FiberSemaphore&&) noexcept = delete;
+
+		void acquire();
+		bool try_acquire();
+		void release(std::ptrdiff_t update = 1);
+
+	private:
+		static bool ShouldPark(const void* semaphore, std::uintptr_t);
+	};
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <atomic>  // std::atomic
+#include <cstdint>  // std::uintptr_t
+
+namespace Jobs
+{
+	// Fiber-safe reader-writer mutex, parks contended lockers in the ParkingLot the same way FiberMutex does.
+	// Satisfies named requirements of Lockable and SharedLockable.
+	// Writers are preferred, new readers queue up behind a waiting writer. When a writer unlocks, all of the readers that queued up
+	// behind it are woken in one batch before the next writer gets its turn, so neither side starves.
+	// Usable outside of jobs as well, threads block instead.
+	class FiberSharedMutex
+	{
+		static constexpr unsigned int maxSpin = 64;  // Fast path retries before parking.
+
+		// State layout, the reader count sits above the flags.
+		static constexpr unsigned int writer = 1;  // Held exclusively.
+		static constexpr unsigned int writersWaiting = 2;
+		static constexpr unsigned int readersWaiting = 4;
+		static constexpr unsigned int reader = 8;  // One shared holder.
+
+		static constexpr std::uintptr_t handOffToken = 1;
+
+	private:
+		// Writers park on the state, readers on the gate. Woken waiters are either handed the mutex or retry.
+		std::atomic<unsigned int> state{ 0 };
+		char readerGate = 0;  // Only its address is used.
+
+	public:
+		FiberSharedMutex() = default;
+		~FiberSharedMutex() = default;
+
+		FiberSharedMutex(const FiberSharedMutex&) = delete;
+		FiberSharedMutex(FiberSharedMutex&&) noexcept = delete;
+
+		FiberSharedMutex& operator=(const FiberSharedMutex&) = delete;
+		FiberSharedMutex& operator=(FiberSharedMutex&&) noexcept = delete;
+
+		void lock();
+		bool try_lock();
+		void unlock();
+
+		void lock_shared();
+		bool try_lock_shared();
+		void unlock_shared();
+
+	private:
+		void LockSlow();
+		void LockSharedSlow();
+
+		// Slow path of an unlock, passes the mutex on to the waiters that are next in line.
+		void HandOff(bool exclusive);
+		void WakeReaders();
+
+		static bool ShouldParkExclusive(const void* mutex, std::uintptr_t);
+		static bool ShouldParkShared(const void* mutex, std::uintptr_t);
+
+		// Unpark callbacks, run under the parking lot's lock.
+		static std::uintptr_t HandOffFromWriter(void* mutex, bool unparked, bool mayHaveMore);
+		static std::uintptr_t HandOffFromReaders(void* mutex, bool unparked, bool mayHaveMore);
+		static std::uintptr_t HandOffToReader(void* mutex, bool unparked, bool mayHaveMore);
+	};
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <Jobs/CounterHandle.h>
+
+#include <cstddef>  // std::size_t, std::byte
+#include <memory>  // std::unique_ptr
+#include <vector>  // std::vector
+
+namespace Jobs
+{
+	namespace Detail
+	{
+		// Bump allocator for everything a frame creates and throws away. Owned by a single worker, so nothing is synchronized.
+		// Resetting rewinds to the first chunk and keeps every chunk around, so a steady state frame never touches the heap.
+		class FrameArena
+		{
+			static constexpr size_t chunkSize = 256 * 1024;  // 256 kB
+
+		private:
+			struct Chunk
+			{
+				std::unique_ptr<std::byte[]> memory;
+				size_t size = 0;
+			};
+
+			std::vector<Chunk> chunks;
+			size_t current = 0;  // Chunk we're bumping in.
+			size_t offset = 0;  // Into the current chunk.
+
+			std::vector<CounterHandle<>> counters;  // Counters made in this frame, kept alive until the end of it for the pending work check.
+
+		public:
+			FrameArena() = default;
+			FrameArena(const FrameArena&) = delete;
+			FrameArena(FrameArena&&) noexcept = default;
+
+			FrameArena& operator=(const FrameArena&) = delete;
+			FrameArena& operator=(FrameArena&&) noexcept = default;
+
+			void* Allocate(size_t size, size_t alignment);
+
+			// Pooled like any other counter rather than bump allocated, so handles may outlive the frame and resetting never waits on them.
+			CounterHandle<> MakeCounter(Counter<>::Type initialValue);
+
+			// Releases everything. Returns false if a counter of this frame still had pending work.
+			bool Reset();
+		};
+	}
+}
@@ -0,0 +1,405 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <Jobs/Manager.h>
+#include <Jobs/Counter.h>
+#include <Jobs/CounterHandle.h>
+#include <Jobs/Assert.h>
+
+#include <atomic>  // std::atomic
+#include <tuple>  // std::tuple
+#include <vector>  // std::vector
+#include <utility>  // std::move, std::forward
+#include <type_traits>  // std::conditional, std::invoke_result, std::is_void
+#include <new>  // placement new, std::launder
+#include <cstddef>  // std::size_t, std::byte
+
+namespace Jobs
+{
+	template <typename T>
+	class Future;
+
+	template <typename T>
+	class Promise;
+
+	namespace Detail
+	{
+		struct FutureVoid {};
+
+		template <typename T>
+		using FutureValueType = std::conditional_t<std::is_void_v<T>, FutureVoid, T>;
+
+		// Result of a callable invoked like a job, with the executing manager if it takes one.
+		template <typename Callable, typename Decayed = std::decay_t<Callable>>
+		using AsyncResultType = typename std::conditional_t<std::is_invocable_v<Decayed&, Manager*>, std::invoke_result<Decayed&, Manager*>, std::invoke_result<Decayed&>>::type;
+
+		// The value and its readiness in one pooled allocation. The state is a counter itself, so futures, promises and the jobs
+		// producing or consuming the value all share its intrusive reference count. The count reaches zero once the value is set.
+		template <typename T>
+		struct FutureState : Counter<>
+		{
+			using ValueType = FutureValueType<T>;
+
+			Manager* owner = nullptr;  // Runs the continuations.
+			std::atomic_bool claimed{ false };  // Set once a value is on its way, only the first of several producers gets to set it.
+			alignas(ValueType) std::byte storage[sizeof(ValueType)];
+
+			FutureState(Manager* inOwner, Counter<>::Type initialValue) : Counter<>(initialValue), owner(inOwner)
+			{
+				release = &FutureState::Release;
+			}
+
+			~FutureState()
+			{
+				// Everyone who could still be setting the value holds a reference, so by now a claimed value is fully constructed.
+				if (claimed.load(std::memory_order_relaxed))
+				{
+					GetValue().~ValueType();
+				}
+			}
+
+			ValueType& GetValue()
+			{
+				return *std::launder(reinterpret_cast<ValueType*>(storage));
+			}
+
+			template <typename... Arguments>
+			void Construct(Arguments&&... arguments)
+			{
+				new (storage) ValueType(std::forward<Arguments>(arguments)...);
+			}
+
+			// Invokes the function and keeps its result, void results are stored as an empty value.
+			template <typename Function, typename... Arguments>
+			void ConstructFrom(Function& function, Arguments&&... arguments)
+			{
+				if constexpr (std::is_void_v<T>)
+				{
+					function(std::forward<Arguments>(arguments)...);
+					Construct();
+				}
+
+				else
+				{
+					Construct(function(std::forward<Arguments>(arguments)...));
+				}
+			}
+
+			// For producers racing each other, such as promises and WhenAny(). Returns false if someone else got there first.
+			template <typename... Arguments>
+			bool TrySet(Arguments&&... arguments)
+			{
+				if (claimed.exchange(true, std::memory_order_acq_rel))
+				{
+					return false;
+				}
+
+				Construct(std::forward<Arguments>(arguments)...);
+				operator--();  // Publishes the value to whoever waits on us.
+
+				return true;
+			}
+
+			static void Release(Counter<>* counter)
+			{
+				auto* state{ static_cast<FutureState*>(counter) };
+				state->~FutureState();
+
+				SizeClassAllocator<FutureState>::Free(state);
+			}
+		};
+
+		// States made for a job start out at zero, the job arrives on them when enqueued and departs once the value is stored.
+		template <typename T>
+		CounterHandle<> MakeFutureState(Manager* owner, Counter<>::Type initialValue = 0)
+		{
+			auto* state{ new (SizeClassAllocator<FutureState<T>>::Allocate()) FutureState<T>{ owner, initialValue } };
+
+			return CounterHandle<>{ static_cast<Counter<>&>(*state) };
+		}
+
+		// Calls the function once a counter reaches zero, without a job or a fiber waiting in the meantime. Runs on whoever brings the
+		// counter to zero, or right away if it's already there.
+		template <typename Function>
+		struct CallbackLink : CounterLink
+		{
+			Function function;
+
+			explicit CallbackLink(Function&& inFunction) : function(std::move(inFunction))
+			{
+				satisfied = &CallbackLink::Satisfied;
+			}
+
+			static void Attach(Counter<>& counter, Function function)
+			{
+				auto* link{ new (SizeClassAllocator<CallbackLink>::Allocate()) CallbackLink{ std::move(function) } };
+
+				counter.Link(*link, 0);
+
+				// A counter that reached zero before we linked won't notify us. Whoever detaches the link runs it, either us or the counter.
+				if (counter.Get() == 0 && counter.Unlink(*link))
+				{
+					Satisfied(*link);
+				}
+			}
+
+			static void Satisfied(CounterLink& link)
+			{
+				auto* self{ static_cast<CallbackLink*>(&link) };
+				self->function();
+
+				self->~CallbackLink();
+				SizeClassAllocator<CallbackLink>::Free(self);
+			}
+		};
+
+		template <typename Function>
+		void OnZero(Counter<>& counter, Function&& function)
+		{
+			CallbackLink<std::decay_t<Function>>::Attach(counter, std::forward<Function>(function));
+		}
+
+		struct FutureAccess
+		{
+			template <typename T>
+			static Future<T> Make(CounterHandle<> state)
+			{
+				return Future<T>{ std::move(state) };
+			}
+
+			template <typename T>
+			static FutureState<T>& GetState(const Future<T>& future)
+			{
+				return static_cast<FutureState<T>&>(*future.state);
+			}
+		};
+	}
+
+	// Result of a job. Copies share the same value. Waiting parks the fiber inside of a job, and blocks the thread anywhere else.
+	template <typename T>
+	class Future
+	{
+		friend struct Detail::FutureAccess;
+
+	private:
+		CounterHandle<> state;
+
+		explicit Future(CounterHandle<> inState) : state(std::move(inState)) {}
+
+	public:
+		Future() = default;
+
+		bool IsReady() const
+		{
+			return state->Get() == 0;
+		}
+
+		// Blocking operation.
+		void Wait() const
+		{
+			state->Wait(0);
+		}
+
+		// Blocking operation. The value lives as long as any future to it does.
+		std::add_lvalue_reference_t<T> Get() const
+		{
+			Wait();
+
+			if constexpr (!std::is_void_v<T>)
+			{
+				return Detail::FutureAccess::GetState(*this).GetValue();
+			}
+		}
+
+		// Reaches zero once the value is ready, so that plain jobs can depend on it.
+		const CounterHandle<>& GetCounter() const
+		{
+			return state;
+		}
+
+		// Runs the function with our value as a job once the value is ready, and returns a future of its result. Nothing waits in the
+		// meantime, the job is enqueued by whoever makes the value ready.
+		template <typename Function>
+		auto Then(Function&& function) const;
+
+		explicit operator bool() const { return static_cast<bool>(state); }
+	};
+
+	// Manually provided value of a future, for results that don't come from a single job. Must be given a value before it goes away.
+	template <typename T>
+	class Promise
+	{
+	private:
+		CounterHandle<> state;
+
+	public:
+		explicit Promise(Manager& owner) : state(Detail::MakeFutureState<T>(&owner, 1)) {}
+		Promise(const Promise&) = delete;
+		Promise(Promise&&) noexcept = default;
+
+		~Promise()
+		{
+			JOBS_ASSERT(!state || static_cast<Detail::FutureState<T>&>(*state).claimed.load(std::memory_order_relaxed), "Promise destroyed without a value, its futures can never become ready.");
+		}
+
+		Promise& operator=(const Promise&) = delete;
+		Promise& operator=(Promise&&) noexcept = default;
+
+		Future<T> GetFuture() const
+		{
+			return Detail::FutureAccess::Make<T>(state);
+		}
+
+		// Void promises take no arguments. Only the first value is kept.
+		template <typename... Arguments>
+		void SetValue(Arguments&&... arguments)
+		{
+			[[maybe_unused]] const auto set{ static_cast<Detail::FutureState<T>&>(*state).TrySet(std::forward<Arguments>(arguments)...) };
+
+			JOBS_ASSERT(set, "Promise already has a value.");
+		}
+	};
+
+	template <typename Callable>
+	auto Manager::Async(Callable&& function)
+	{
+		using Result = Detail::AsyncResultType<Callable>;
+
+		auto state{ Detail::MakeFutureState<Result>(this) };
+		auto* typedState{ &static_cast<Detail::FutureState<Result>&>(*state) };
+
+		// The job's own counter keeps the state alive and marks it ready when the job departs, so the value costs no extra signaling.
+		Enqueue([typedState, function = std::forward<Callable>(function)](Manager* owner) mutable
+		{
+			auto invoke{ [&function, owner]() -> decltype(auto) { return Detail::InvokeJobCallable(function, owner); } };
+
+			typedState->ConstructFrom(invoke);
+			typedState->claimed.store(true, std::memory_order_relaxed);  // Published by the departure.
+		}, state);
+
+		return Detail::FutureAccess::Make<Result>(std::move(state));
+	}
+
+	template <typename T>
+	template <typename Function>
+	auto Future<T>::Then(Function&& function) const
+	{
+		using Result = std::conditional_t<std::is_void_v<T>, std::invoke_result<std::decay_t<Function>&>, std::invoke_result<std::decay_t<Function>&, std::add_lvalue_reference_t<T>>>;
+
+		auto& previous{ Detail::FutureAccess::GetState(*this) };
+
+		JOBS_ASSERT(previous.owner, "Continuations need a manager to run on.");
+
+		// Only enqueued once we're ready, so the next state can't rely on the job's counter. The job marks it ready itself instead.
+		auto next{ Detail::MakeFutureState<typename Result::type>(previous.owner, 1) };
+
+		// The job keeps both states alive until it's done with them.
+		Job job{ [previousState = state, typedPrevious = &previous, next, function = std::forward<Function>(function)]() mutable
+		{
+			auto& typedNext{ static_cast<Detail::FutureState<typename Result::type>&>(*next) };
+
+			if constexpr (std::is_void_v<T>)
+			{
+				typedNext.ConstructFrom(function);
+			}
+
+			else
+			{
+				typedNext.ConstructFrom(function, typedPrevious->GetValue());
+			}
+
+			typedNext.claimed.store(true, std::memory_order_relaxed);
+			--typedNext;  // Publishes the value.
+		} };
+
+		Detail::OnZero(previous, [owner = previous.owner, job = std::move(job)]() mutable
+		{
+			owner->Enqueue(std::move(job));
+		});
+
+		return Detail::FutureAccess::Make<typename Result::type>(std::move(next));
+	}
+
+	namespace Detail
+	{
+		// Each future counts the state down once it's ready.
+		template <typename T>
+		void WhenAllAttach(const CounterHandle<>& result, const Future<T>& future)
+		{
+			OnZero(*future.GetCounter(), [result] { --*result; });
+		}
+
+		// The first future to be ready reports its index. The links of the rest stay behind until their futures are ready as well.
+		template <typename T>
+		void WhenAnyAttach(const CounterHandle<>& result, const Future<T>& future, size_t index)
+		{
+			OnZero(*future.GetCounter(), [result, index]
+			{
+				static_cast<FutureState<size_t>&>(*result).TrySet(index);
+			});
+		}
+	}
+
+	// Ready once every future is, holds the futures themselves. Neither this nor WhenAny() takes up a job or a fiber while waiting.
+	template <typename... Ts>
+	Future<std::tuple<Future<Ts>...>> WhenAll(Manager& manager, Future<Ts>... futures)
+	{
+		using Result = std::tuple<Future<Ts>...>;
+
+		auto state{ Detail::MakeFutureState<Result>(&manager, sizeof...(Ts)) };
+		auto& typedState{ static_cast<Detail::FutureState<Result>&>(*state) };
+
+		// The value is in place before anyone can count us down.
+		typedState.Construct(futures...);
+		typedState.claimed.store(true, std::memory_order_relaxed);
+
+		(Detail::WhenAllAttach(state, futures), ...);
+
+		return Detail::FutureAccess::Make<Result>(std::move(state));
+	}
+
+	template <typename T>
+	Future<std::vector<Future<T>>> WhenAll(Manager& manager, std::vector<Future<T>> futures)
+	{
+		using Result = std::vector<Future<T>>;
+
+		auto state{ Detail::MakeFutureState<Result>(&manager, static_cast<Counter<>::Type>(futures.size())) };
+		auto& typedState{ static_cast<Detail::FutureState<Result>&>(*state) };
+
+		typedState.Construct(std::move(futures));
+		typedState.claimed.store(true, std::memory_order_relaxed);
+
+		for (const auto& future : typedState.GetValue())
+		{
+			Detail::WhenAllAttach(state, future);
+		}
+
+		return Detail::FutureAccess::Make<Result>(std::move(state));
+	}
+
+	// Ready once any of the futures is, holds the index of that future.
+	template <typename... Ts>
+	Future<size_t> WhenAny(Manager& manager, const Future<Ts>&... futures)
+	{
+		auto state{ Detail::MakeFutureState<size_t>(&manager, 1) };
+
+		size_t index{ 0 };
+		(Detail::WhenAnyAttach(state, futures, index++), ...);
+
+		return Detail::FutureAccess::Make<size_t>(std::move(state));
+	}
+
+	template <typename T>
+	Future<size_t> WhenAny(Manager& manager, const std::vector<Future<T>>& futures)
+	{
+		auto state{ Detail::MakeFutureState<size_t>(&manager, 1) };
+
+		for (size_t iter{ 0 }; iter < futures.size(); ++iter)
+		{
+			Detail::WhenAnyAttach(state, futures[iter], iter);
+		}
+
+		return Detail::FutureAccess::Make<size_t>(std::move(state));
+	}
+}
\ No newline at end of file
@@ -2,19 +2,174 @@
 
 #pragma once
 
-#include <Jobs/Counter.h>
-#include <Jobs/DependencyAllocator.h>
+#include <Jobs/CounterHandle.h>
+#include <Jobs/JobHandle.h>
+#include <Jobs/Allocator.h>
 #include <Jobs/Assert.h>
 
-#include <memory>  // std::shared_ptr, std::weak_ptr
+#include <memory>  // std::unique_ptr
 #include <vector>  // std::vector
-#include <utility>  // std::pair
+#include <memory_resource>  // std::pmr::memory_resource, std::pmr::vector
+#include <utility>  // std::pair, std::move, std::forward
+#include <type_traits>  // std::is_invocable, std::enable_if
+#include <new>  // std::launder
+#include <cstddef>  // std::size_t, std::byte
+#include <cstdint>  // std::uint32_t
 
 namespace Jobs
 {
+	class Manager;
+	class Job;
+
+	namespace Detail
+	{
+		struct JobTree;  // Stages of a JobBuilder, see JobBuilder.h.
+
+		// The manager's resource when called from one of its jobs, the default resource anywhere else. See Manager::SetMemoryResource().
+		std::pmr::memory_resource* GetCurrentMemoryResource();
+
+		struct JobTreeDeleter
+		{
+			void operator()(JobTree* tree) const;  // Returns the tree to its pool, see JobBuilder.cpp.
+		};
+
+		// Rarely used parts of a job, kept out of line so that every job doesn't pay for them in the queues.
+		struct JobExtension
+		{
+			// List of dependencies this job needs before executing. Pairs of counters to expected values.
+			using DependencyType = std::pair<CounterHandle<>, Counter<>::Type>;
+			std::pmr::vector<DependencyType> dependencies;
+
+			// Only set for builders. Released along with the job once it has enqueued its stages.
+			std::unique_ptr<JobTree, JobTreeDeleter> tree;
+
+			explicit JobExtension(std::pmr::memory_resource* resource) : dependencies(resource) {}
+			JobExtension(const JobExtension& other) : dependencies(other.dependencies, other.dependencies.get_allocator()) {}  // Trees have a single owner, copies don't get one.
+		};
+
+		using JobExtensionPool = SizeClassAllocator<JobExtension>;
+
+		struct JobExtensionDeleter
+		{
+			void operator()(JobExtension* extension) const
+			{
+				extension->~JobExtension();
+				JobExtensionPool::Free(extension);
+			}
+		};
+
+		// Callables up to this size are stored in the job itself, anything larger in a pooled allocation.
+		constexpr size_t jobInlineSize = 3 * sizeof(void*);
+		constexpr size_t jobInlineAlignment = alignof(void*);
+
+		// Anything invoked with no arguments or with the executing manager, other than the plain function pointers a job already takes.
+		template <typename Callable, typename Decayed = std::decay_t<Callable>>
+		constexpr bool isJobCallable = !std::is_base_of_v<Job, Decayed> && !std::is_convertible_v<Decayed, void(*)(Manager*, void*)> &&
+			(std::is_invocable_v<Decayed&> || std::is_invocable_v<Decayed&, Manager*>);
+
+		template <typename Callable>
+		decltype(auto) InvokeJobCallable(Callable& callable, Manager* owner)
+		{
+			if constexpr (std::is_invocable_v<Callable&, Manager*>)
+			{
+				return callable(owner);
+			}
+
+			else
+			{
+				return callable();
+			}
+		}
+
+		// Type erased lifetime of the callable in a job, the job's entry invokes it.
+		struct JobCallable
+		{
+			void (*relocate)(void* from, void* to);  // Move constructs the callable into to, then destroys it in from.
+			void (*copy)(const void* from, void* to);  // Null for move-only callables.
+			void (*destroy)(void* storage);
+		};
+
+		template <typename Callable>
+		struct JobCallableTraits
+		{
+			// Moving through the queues must not throw, so only callables with a nothrow move can live inline.
+			static constexpr bool isInline = sizeof(Callable) <= jobInlineSize && alignof(Callable) <= jobInlineAlignment && std::is_nothrow_move_constructible_v<Callable>;
+
+			static Callable& Get(void* storage)
+			{
+				if constexpr (isInline)
+				{
+					return *std::launder(static_cast<Callable*>(storage));
+				}
+
+				else
+				{
+					return **static_cast<Callable**>(storage);  // The storage holds the pooled pointer.
+				}
+			}
+
+			template <typename... Arguments>
+			static void Construct(void* storage, Arguments&&... arguments)
+			{
+				if constexpr (isInline)
+				{
+					new (storage) Callable(std::forward<Arguments>(arguments)...);
+				}
+
+				else
+				{
+					*static_cast<Callable**>(storage) = new (SizeClassAllocator<Callable>::Allocate()) Callable(std::forward<Arguments>(arguments)...);
+				}
+			}
+
+			static void Invoke(Manager* owner, void* storage)
+			{
+				InvokeJobCallable(Get(storage), owner);
+			}
+
+			static void Relocate(void* from, void* to)
+			{
+				if constexpr (isInline)
+				{
+					auto& source{ Get(from) };
+					new (to) Callable(std::move(source));
+					source.~Callable();
+				}
+
+				else
+				{
+					*static_cast<Callable**>(to) = *static_cast<Callable**>(from);
+				}
+			}
+
+			static void Copy(const void* from, void* to)
+			{
+				// Only referenced for copyable callables, see operations.
+				if constexpr (std::is_copy_constructible_v<Callable>)
+				{
+					Construct(to, static_cast<const Callable&>(Get(const_cast<void*>(from))));
+				}
+			}
+
+			static void Destroy(void* storage)
+			{
+				auto& callable{ Get(storage) };
+				callable.~Callable();
+
+				if constexpr (!isInline)
+				{
+					SizeClassAllocator<Callable>::Free(&callable);
+				}
+			}
+
+			static constexpr JobCallable operations{ &Relocate, std::is_copy_constructible_v<Callable> ? &Copy : nullptr, &Destroy };
+		};
+	}
+
 	class Job
 	{
 		friend class Manager;
+		friend class JobBuilder;
 		friend void ManagerFiberEntry(void*);
 
 	public:
@@ -22,34 +177,181 @@ namespace Jobs
 		EntryType entry = nullptr;
 
 	protected:
-		bool stream = false;  // Bit to determine if we're a stream structure (JobBuilder).
+		const Detail::JobCallable* callable = nullptr;  // Set if we were made from a callable, which then lives in the storage.
+
+		union
+		{
+			void* data = nullptr;
+			alignas(Detail::jobInlineAlignment) std::byte storage[Detail::jobInlineSize];  // The callable, or a pointer to it if it didn't fit.
+		};
 
-		void* data = nullptr;
-		std::weak_ptr<Counter<>> atomicCounter;
+		CounterHandle<> counter;  // Held until we depart.
+		std::unique_ptr<Detail::JobExtension, Detail::JobExtensionDeleter> extension;  // Pooled, only allocated once a dependency or a builder stage is added.
+		std::uint32_t counterShard = 0;  // Shard of a sharded counter we arrived on, we depart from the same one.
 
-		// List of dependencies this job needs before executing. Pairs of counters to expected values.
-		using DependencyType = std::pair<std::weak_ptr<Counter<>>, Counter<>::Type>;
-		// MSVC throws errors with the stack allocator in debugging mode, so just turn it off unless we're in an optimized build.
-#if !NDEBUG
-		std::vector<DependencyType> dependencies;
-#else
-		std::vector<DependencyType, DependencyAllocator<DependencyType, 2>> dependencies;
-#endif
+		bool stream = false;  // Bit to determine if we're a stream structure (JobBuilder).
+		bool pinned = false;  // Once started, always resume on the same worker after a suspension.
 
 	public:
 		Job() = default;
 		Job(EntryType inEntry, void* inData = nullptr) : entry(inEntry), data(inData) {}
 
-		void AddDependency(const std::shared_ptr<Counter<>>& handle, const Counter<>::Type expectedValue = Counter<>::Type{ 0 })
+		// Takes ownership of any callable, invoked with either no arguments or the executing manager. Small callables are stored
+		// inline, larger ones come from a pool. Either way the callable is destroyed once the job has finished, before the counter is notified.
+		template <typename Callable, typename = std::enable_if_t<Detail::isJobCallable<Callable>>>
+		Job(Callable&& function)
+		{
+			using Traits = Detail::JobCallableTraits<std::decay_t<Callable>>;
+
+			Traits::Construct(storage, std::forward<Callable>(function));
+			callable = &Traits::operations;
+			entry = &Traits::Invoke;
+		}
+
+		// Jobs holding a move-only callable can't be copied, and neither can builders, their stages can only be enqueued once. Either
+		// terminates rather than handing back a job that would do nothing.
+		Job(const Job& other) : entry(other.entry), callable(other.callable), counter(other.counter), counterShard(other.counterShard), stream(other.stream), pinned(other.pinned)
+		{
+			JOBS_VERIFY(!stream, "Attempted to copy a job builder.");
+
+			if (callable)
+			{
+				JOBS_VERIFY(callable->copy, "Attempted to copy a job holding a move-only callable.");
+
+				callable->copy(other.storage, storage);
+			}
+
+			else
+			{
+				data = other.data;
+			}
+
+			if (other.extension)
+			{
+				extension.reset(new (Detail::JobExtensionPool::Allocate()) Detail::JobExtension{ *other.extension });
+			}
+		}
+
+		Job(Job&& other) noexcept
+		{
+			MoveFrom(std::move(other));
+		}
+
+		~Job()
+		{
+			DestroyCallable();
+		}
+
+		Job& operator=(const Job& other)
+		{
+			if (this != &other)
+			{
+				*this = Job{ other };
+			}
+
+			return *this;
+		}
+
+		Job& operator=(Job&& other) noexcept
+		{
+			if (this != &other)
+			{
+				DestroyCallable();
+				MoveFrom(std::move(other));
+			}
+
+			return *this;
+		}
+
+		// Opt-in for jobs that rely on thread affinity (thread locals, OS handles) across a suspension point such as FiberMutex::lock().
+		// The job can still start on any worker, but once running it is only ever resumed by that worker, never stolen.
+		void SetPinned(bool inPinned = true)
+		{
+			pinned = inPinned;
+		}
+
+		// Resource for the dependency list, set before adding any. Copies of the job share it.
+		void SetMemoryResource(std::pmr::memory_resource* resource)
 		{
-			dependencies.push_back({ handle, expectedValue });
+			JOBS_ASSERT(!extension || extension->dependencies.empty(), "Memory resources must be set before adding dependencies.");
+
+			// Containers keep the resource they were made with, so the extension is made over. Builders keep their tree.
+			auto tree{ extension ? std::move(extension->tree) : nullptr };
+			extension.reset(new (Detail::JobExtensionPool::Allocate()) Detail::JobExtension{ resource });
+			extension->tree = std::move(tree);
+		}
+
+		void AddDependency(const CounterHandle<>& handle, const Counter<>::Type expectedValue = Counter<>::Type{ 0 })
+		{
+			GetExtension().dependencies.push_back({ handle, expectedValue });
+		}
+
+		// Runs after a tracked job has finished. Nothing to wait on if it's already done.
+		void AddDependency(const JobHandle& handle)
+		{
+			if (auto counter{ handle ? handle.slots->Retain(handle.GetIndex(), handle.GetGeneration()) : CounterHandle<>{} })
+			{
+				AddDependency(counter);
+			}
 		}
 
 		void operator()(Manager* owner)
 		{
-			JOBS_ASSERT(entry, "Attempted to execute empty job.");
+			JOBS_VERIFY(entry, "Attempted to execute empty job.");
+
+			return entry(owner, callable ? static_cast<void*>(storage) : data);
+		}
+
+	protected:
+		Detail::JobExtension& GetExtension()
+		{
+			if (!extension)
+			{
+				extension.reset(new (Detail::JobExtensionPool::Allocate()) Detail::JobExtension{ Detail::GetCurrentMemoryResource() });
+			}
 
-			return entry(owner, data);
+			return *extension;
+		}
+
+	private:
+		// Expects our own callable to be destroyed already.
+		void MoveFrom(Job&& other) noexcept
+		{
+			entry = other.entry;
+			callable = other.callable;
+			counter = std::move(other.counter);
+			extension = std::move(other.extension);
+			counterShard = other.counterShard;
+			stream = other.stream;
+			pinned = other.pinned;
+
+			if (callable)
+			{
+				callable->relocate(other.storage, storage);
+
+				// The callable is ours now, the other job is left empty.
+				other.entry = nullptr;
+				other.callable = nullptr;
+			}
+
+			else
+			{
+				data = other.data;
+			}
+		}
+
+		void DestroyCallable()
+		{
+			if (callable)
+			{
+				callable->destroy(storage);
+				callable = nullptr;
+			}
 		}
 	};
+
+	// Queues store jobs by value, every enqueue, dequeue and steal moves one. Jobs are deliberately not trivially copyable: the counter
+	// and extension are owning handles, and callables stored inline may have a move of their own, which goes through JobCallable::relocate.
+	// A move is a handful of pointer copies otherwise, the size is what the queues pay for.
+	static_assert(sizeof(Job) <= 64, "Jobs should fit in a cache line.");
 }
\ No newline at end of file
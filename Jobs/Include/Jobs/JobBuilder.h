@@ -6,86 +6,88 @@
 
 namespace Jobs
 {
+	namespace Detail
+	{
+		struct JobTree
+		{
+			std::pmr::vector<std::pmr::vector<Job>> stages;  // Stages share the resource of the tree.
+
+			// Covers the builder's own job and the final stage, which can't finish before the stages leading up to it.
+			CounterHandle<> completion{ MakeCounter() };
+
+			explicit JobTree(std::pmr::memory_resource* resource) : stages(resource) {}
+		};
+
+		using JobTreePool = SizeClassAllocator<JobTree>;
+	}
+
+	// Adds no members of its own, the stages live in the job's extension. Enqueueing slices us into a plain job without losing anything.
+	// Enqueueing returns a completion handle, which reaches zero once every stage has finished.
 	class JobBuilder : public Job
 	{
 		friend class Manager;
+		friend void ManagerFiberEntry(void*);
 
 	private:
-		using TreeType = std::vector<std::pair<std::vector<Job>, std::shared_ptr<Counter<>>>>;
-		TreeType* jobTree = nullptr;  // We need a heap pointer so that the counter resources can be managed beyond the lifetime of this object, which will be thrown away once we execute.
-
-		// Disabled indefinitely (for usage outside of the job system's internals). Did not find a clean solution for having the cleanup job signal
-		// this object that the resource has been destroyed. Attempting to get the counter without such synchronization is unsafe since the cleanup
-		// job will kill the memory we're waiting on. Previous attempts include wrapping JobTree in a shared pointer, which doesn't work since we can't
-		// get a copy of that strong pointer over to the job, rebuilding a shared pointer would duplicate the reference counter. Also tried using a
-		// custom data wrapper with an atomic flag, but ran into the same problem.
-		Counter<>& GetCounter() const
+		Detail::JobTree& GetTree() { return *extension->tree; }
+
+		static const CounterHandle<>& GetCounter(const Job& job)
 		{
-			return *std::prev(jobTree->end())->second;  // Return the last counter.
+			return job.extension->tree->completion;
 		}
 
-	public:
-		JobBuilder() = default;
-		JobBuilder(Job::EntryType entry, void* data = nullptr) : Job(entry, data) { stream = true; jobTree = new TreeType{}; }
-		JobBuilder(const JobBuilder&) = default;
-		// Do not delete JobTree in the destructor, that would tie us to a stack lifetime.
+		static void Execute(Job& job, Manager* owner);  // Runs the job, then enqueues the stages.
 
-		// Since we rely on slicing, we need to be careful about swapping garbage.
-		JobBuilder(JobBuilder&& other) noexcept : Job(other)
+		void MakeTree(std::pmr::memory_resource* resource = Detail::GetCurrentMemoryResource())
 		{
-			if (other.stream)
-			{
-				jobTree = std::move(other.jobTree);
-			}
+			stream = true;
+			GetExtension().tree.reset(new (Detail::JobTreePool::Allocate()) Detail::JobTree{ resource });
 		}
 
-		JobBuilder& operator=(JobBuilder&& other) noexcept
-		{
-			Job::operator=(std::forward<Job>(static_cast<Job&&>(other)));
+	public:
+		JobBuilder() = default;
+		JobBuilder(Job::EntryType entry, void* data = nullptr) : Job(entry, data) { MakeTree(); }
 
-			if (other.stream)
-			{
-				jobTree = std::move(other.jobTree);
-			}
+		template <typename Callable, typename = std::enable_if_t<Detail::isJobCallable<Callable>>>
+		JobBuilder(Callable&& function) : Job(std::forward<Callable>(function)) { MakeTree(); }
 
-			return *this;
+		JobBuilder(const JobBuilder&) = delete;
+		JobBuilder(JobBuilder&&) noexcept = default;
+
+		JobBuilder& operator=(const JobBuilder&) = delete;
+		JobBuilder& operator=(JobBuilder&&) noexcept = default;
+
+		// Resource for the dependency list and the stages, set before adding either.
+		void SetMemoryResource(std::pmr::memory_resource* resource)
+		{
+			JOBS_ASSERT(GetTree().stages.empty(), "Memory resources must be set before adding stages.");
+
+			Job::SetMemoryResource(resource);
+			MakeTree(resource);
 		}
-		
+
+		// Jobs passed as rvalues are moved into the stage, so they may hold move-only callables.
 		template <typename... T>
 		JobBuilder& Then(T&&... next)
 		{
 			static_assert((std::is_same_v<std::decay_t<decltype(next)>, Job> && ...), "Job building can only append jobs in Then()");
 
-			jobTree->push_back(std::make_pair(std::vector{ next... }, std::make_shared<Counter<>>()));  // #TODO: Heap pool.
+			auto& stage{ GetTree().stages.emplace_back() };
+			stage.reserve(sizeof...(next));
+			(stage.emplace_back(std::forward<T>(next)), ...);
 
 			return *this;
 		}
-
-		// Disabled indefinitely. See GetCounter().
-		/*
-		void Wait(Counter<>::Type expectedValue)
-		{
-			if (auto thisCounter{ std::move(GetCounter()) }; thisCounter)
-			{
-				thisCounter->Wait(expectedValue);
-			}
-		}
-
-		template <typename Rep, typename Period>
-		void WaitFor(Counter<>::Type expectedValue, const std::chrono::duration<Rep, Period>& timeout)
-		{
-			if (auto thisCounter{ std::move(GetCounter()) }; thisCounter)
-			{
-				thisCounter->WaitFor(expectedValue, timeout);
-			}
-		}
-		*/
-
-		void operator()(Manager* owner);
 	};
 
 	inline JobBuilder MakeJob(Job::EntryType entry, void* data = nullptr)
 	{
 		return JobBuilder{ entry, data };
 	}
+
+	template <typename Callable, typename = std::enable_if_t<Detail::isJobCallable<Callable>>>
+	JobBuilder MakeJob(Callable&& function)
+	{
+		return JobBuilder{ std::forward<Callable>(function) };
+	}
 }
\ No newline at end of file
@@ -0,0 +1,107 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <Jobs/Counter.h>
+#include <Jobs/CounterHandle.h>
+#include <Jobs/Spinlock.h>
+
+#include <atomic>  // std::atomic
+#include <memory>  // std::unique_ptr
+#include <cstddef>  // std::size_t
+#include <cstdint>  // std::uint32_t, std::uint64_t, std::uintptr_t
+
+namespace Jobs
+{
+	namespace Detail
+	{
+		class JobSlots;
+
+		// Tracks a single job. The job holds a handle to the counter until it departs, dependents hold one until they're done with it.
+		// Once the last of them lets go, the generation moves on and the slot is free for the next job.
+		struct JobSlot : Counter<>
+		{
+			JobSlots* owner = nullptr;
+			std::uint32_t index = 0;
+			std::atomic<std::uint32_t> generation{ 0 };
+			std::atomic<std::uint32_t> nextFree{ 0 };  // One past the next free index, zero ends the list.
+		};
+
+		// Manager owned slot map. Slots are allocated in blocks which never move, so a stale handle can always read its slot's generation.
+		class JobSlots
+		{
+			static constexpr size_t blockSize = 1024;
+			static constexpr size_t maxBlocks = 1024;  // Roughly a million jobs tracked at once.
+
+		private:
+			std::unique_ptr<std::atomic<JobSlot*>[]> blocks{ std::make_unique<std::atomic<JobSlot*>[]>(maxBlocks) };
+			std::atomic<size_t> blockCount{ 0 };
+			Spinlock growLock;
+
+			// Free list of slot indices. The upper half is a tag bumped on every change, which guards the pop against ABA.
+			std::atomic<std::uint64_t> freeHead{ 0 };
+
+			static void Release(Counter<>* counter);
+			static bool ShouldPark(const void* context, std::uintptr_t generation);
+
+			void Push(JobSlot& slot);
+			JobSlot* Pop();
+			void Grow();
+
+		public:
+			JobSlots() = default;
+			JobSlots(const JobSlots&) = delete;
+			JobSlots(JobSlots&&) noexcept = delete;
+			~JobSlots();
+
+			JobSlots& operator=(const JobSlots&) = delete;
+			JobSlots& operator=(JobSlots&&) noexcept = delete;
+
+			JobSlot& Get(std::uint32_t index) const
+			{
+				return blocks[index / blockSize].load(std::memory_order_acquire)[index % blockSize];
+			}
+
+			// Returns a fresh slot, the caller is expected to hand its counter to the job it tracks right away.
+			JobSlot& Acquire();
+
+			// References the counter of the slot as long as it's still at the given generation, otherwise the job is done and we return nothing.
+			CounterHandle<> Retain(std::uint32_t index, std::uint32_t generation);
+
+			bool IsDone(std::uint32_t index, std::uint32_t generation) const;
+			void Wait(std::uint32_t index, std::uint32_t generation);
+		};
+	}
+
+	// Refers to an enqueued job, see Manager::EnqueueTracked(). An index and a generation into the manager's slot map, so copies are free
+	// and a handle to a job that's long gone simply reports it as done. Must not outlive the manager.
+	class JobHandle
+	{
+		friend class Manager;
+		friend class Job;
+
+	private:
+		Detail::JobSlots* slots = nullptr;
+		std::uint64_t key = 0;  // Index in the upper half, generation in the lower half.
+
+		JobHandle(Detail::JobSlots& inSlots, const Detail::JobSlot& slot) :
+			slots(&inSlots), key((static_cast<std::uint64_t>(slot.index) << 32) | slot.generation.load(std::memory_order_relaxed)) {}
+
+		std::uint32_t GetIndex() const { return static_cast<std::uint32_t>(key >> 32); }
+		std::uint32_t GetGeneration() const { return static_cast<std::uint32_t>(key); }
+
+	public:
+		JobHandle() = default;
+
+		// Finished jobs are done as soon as they depart, even if dependents still hold on to the slot.
+		bool IsDone() const;
+
+		// Blocking operation. Parks the fiber inside of a job, blocks the thread anywhere else.
+		void Wait() const;
+
+		explicit operator bool() const { return slots != nullptr; }
+
+		friend bool operator==(const JobHandle& left, const JobHandle& right) { return left.slots == right.slots && left.key == right.key; }
+		friend bool operator!=(const JobHandle& left, const JobHandle& right) { return !(left == right); }
+	};
+}
\ No newline at end of file
@@ -3,65 +3,84 @@
 #pragma once
 
 #include <Jobs/Worker.h>
+#include <Jobs/JobBuilder.h>
 #include <Jobs/Fiber.h>
-#include <Jobs/Counter.h>
+#include <Jobs/CounterHandle.h>
+#include <Jobs/JobHandle.h>
+#include <Jobs/FrameArena.h>
+#include <Jobs/Allocator.h>
+#include <Jobs/Spinlock.h>
 #include <Jobs/Profiling.h>
 
 #include <vector>  // std::vector
-#include <array>  // std::array
 #include <utility>  // std::move, std::pair
 #include <thread>  // std::thread
 #include <variant>  // std::variant
 #include <mutex>  // std::mutex
 #include <string>  // std::string
-#include <memory>  // std::shared_ptr, std::unique_ptr
 #include <map>  // std::map
 #include <type_traits>  // std::is_same, std::decay
 #include <optional>  // std::optional
-#include <new>  // std::hardware_destructive_interference_size
+#include <chrono>  // std::chrono
+#include <atomic>  // std::atomic
+#include <memory_resource>  // std::pmr::memory_resource
+#include <limits>  // std::numeric_limits
+#include <cstdint>  // std::uintptr_t
+#include <cstddef>  // std::max_align_t
+#include <new>  // placement new
 
 namespace Jobs
 {
-	namespace Detail
-	{
-#ifdef __cpp_lib_hardware_interference_size
-		constexpr auto hardwareDestructiveInterference = std::hardware_destructive_interference_size;
-#else
-		constexpr auto hardwareDestructiveInterference = 64;
-#endif
-	}
-
 	class Manager
 	{
 		friend class Worker;
-		friend class FiberMutex;
+		friend class ParkingLot;
+		friend class Detail::MultiWait;
 		friend void ManagerWorkerEntry(void*);
 		friend void ManagerFiberEntry(void*);
+		friend std::pmr::memory_resource* Detail::GetCurrentMemoryResource();
 
 		// #TODO: Move these into template traits.
+#if JOBS_COPY_STACK_FIBERS
+		static constexpr size_t fiberCount = 16 * 1024;  // Suspended copy-stack fibers only cost the stack they actually used.
+		static constexpr size_t sharedStackSize = 256 * 1024;  // 256 kB, one per worker.
+#else
 		static constexpr size_t fiberCount = 256;
+#endif
 		static constexpr size_t fiberStackSize = 64 * 1024;  // 64 kB
+		static constexpr auto fiberTrimThreshold = std::chrono::seconds{ 5 };  // Time a fiber needs to sit idle before its stack is released to the OS.
+		static constexpr auto fiberTrimInterval = std::chrono::seconds{ 1 };  // Minimum time between automatic trims.
 
 	private:
 		std::vector<Worker> workers;
-		std::array<std::pair<Fiber, std::atomic_bool>, fiberCount> fibers;  // Pool of fibers paired to an availability flag.
-		moodycamel::ConcurrentQueue<size_t> waitingFibers;  // Queue of fiber indices that are waiting for some dependency or scheduled a waiting fiber.
+		std::vector<std::pair<Fiber, std::atomic_bool>> fibers;  // Pool of fibers paired to an availability flag. Sized once in Initialize().
 
 		static constexpr auto invalidID = std::numeric_limits<size_t>::max();
 
-		std::atomic_bool ready;
+		std::atomic_bool ready{ false };
 		alignas(Detail::hardwareDestructiveInterference) std::atomic_bool shutdown;
 
 		// Used to cycle the worker thread to enqueue in.
-		std::atomic_uint enqueueIndex;
+		std::atomic_uint enqueueIndex{ 0 };
+
+		std::atomic<std::chrono::steady_clock::rep> lastTrimTime{ 0 };  // Used to rate limit automatic trims from sleeping workers.
 
-		alignas(Detail::hardwareDestructiveInterference) FutexConditionVariable queueCV;
+		// Workers parked for lack of work, also the address they park on.
+		alignas(Detail::hardwareDestructiveInterference) std::atomic<size_t> sleepingWorkers{ 0 };
 
 		// #TODO: Use a more efficient hash map data structure.
-		std::map<std::string, std::shared_ptr<Counter<>>> groupMap;
+		std::map<std::string, CounterHandle<>> groupMap;
 
-		template <typename U>
-		void EnqueueInternal(U&& job);
+		// One arena per worker, plus one shared by every other thread. See BeginFrame().
+		std::vector<Detail::FrameArena> frameArenas;
+		Spinlock externalFrameLock;
+		std::atomic_bool inFrame{ false };
+
+		Detail::JobSlots jobSlots;  // Backs the handles of tracked jobs, see EnqueueTracked().
+
+		std::atomic<std::pmr::memory_resource*> memoryResource{ GetSmallObjectResource() };
+
+		void EnqueueInternal(Job&& job);
 
 	public:
 		Manager() = default;
@@ -74,53 +93,114 @@ namespace Jobs
 
 		void Initialize(size_t threadCount = 0);
 
+		// Backs the library's own containers: dependency lists and builder stages of jobs made from inside of our jobs, and the working
+		// memory of the algorithms. Jobs and algorithm calls can override it individually. The resource must outlive the manager.
+		// Defaults to the small object allocator, see Allocate().
+		void SetMemoryResource(std::pmr::memory_resource* resource) { memoryResource.store(resource, std::memory_order_relaxed); }
+		std::pmr::memory_resource* GetMemoryResource() const { return memoryResource.load(std::memory_order_relaxed); }
+
+		// Builders return a handle to their completion counter, which reaches zero once every stage has finished.
 		template <typename U>
-		void Enqueue(U&& job);
+		auto Enqueue(U&& job);
 
 		template <size_t Size>
 		void Enqueue(Job (&jobs)[Size]);
 
 		template <typename U>
-		void Enqueue(U&& job, const std::shared_ptr<Counter<>>& counter);
+		void Enqueue(U&& job, const CounterHandle<>& counter);
 
 		template <size_t Size>
-		void Enqueue(Job (&jobs)[Size], const std::shared_ptr<Counter<>>& counter);
+		void Enqueue(Job (&jobs)[Size], const CounterHandle<>& counter);
+
+		// Returns a handle to query, wait on, or depend on the job after the fact. Only costs a slot from the manager's slot map.
+		// At most about a million can be pending or referenced by handles at once, see JobSlots::maxBlocks. One more terminates.
+		template <typename U>
+		JobHandle EnqueueTracked(U&& job);
+
+		// Runs the callable as a job and returns a Future of its result. Defined in Future.h.
+		template <typename Callable>
+		auto Async(Callable&& function);
 
 		template <typename U>
-		std::shared_ptr<Counter<>> Enqueue(U&& job, const std::string& group);
+		CounterHandle<> Enqueue(U&& job, const std::string& group);
 
 		template <size_t Size>
-		std::shared_ptr<Counter<>> Enqueue(Job (&jobs)[Size], const std::string& group);
+		CounterHandle<> Enqueue(Job (&jobs)[Size], const std::string& group);
 
 		size_t GetWorkerCount() const { return workers.size(); }
 
+		// Releases the unused stack memory of every idle fiber back to the OS. Fibers are kept alive and remain schedulable.
+		// This also happens automatically for fibers idle longer than fiberTrimThreshold, but only while workers are cycling.
+		void Trim();
+
+		// Frames serve the short lived allocations of a batch of work, such as job payloads, from per-worker bump allocators. Nothing
+		// is freed individually, EndFrame() releases it all at once. Every job using frame memory must have finished by then, debug
+		// builds check that every frame counter has reached zero.
+		void BeginFrame();
+		void EndFrame();
+
+		// Only valid during a frame. The memory is released without running any destructors.
+		void* AllocateFrame(size_t size, size_t alignment = alignof(std::max_align_t));
+
+		template <typename T, typename... Arguments>
+		T* NewFrame(Arguments&&... arguments);
+
+		// Tracked by the frame for the pending work check. Released along with the last handle like any other counter, so handles may
+		// outlive the frame.
+		CounterHandle<> MakeFrameCounter(Counter<>::Type initialValue = 0);
+
 	private:
-		std::optional<JobBuilder> Dequeue(size_t threadID);
+		std::optional<Job> Dequeue(size_t threadID);
 
 		size_t GetThisThreadID() const;
+		static Manager* GetThisManager();  // Manager of the calling worker, or nullptr outside of the workers.
 		inline bool IsValidID(size_t id) const;
 
 		inline bool CanContinue() const;
 
 		size_t GetAvailableFiber();  // Returns a fiber that is not currently scheduled.
+
+		// Fibers that are waiting for some dependency or scheduled a waiting fiber are queued on the worker they suspended on.
+		void EnqueueWaitingFiber(size_t fiberIndex, size_t threadID);
+		bool DequeueWaitingFiber(size_t threadID, size_t& fiberIndex);  // Favors our own waiters, steals unpinned waiters from other workers if we have none.
+		bool HasWaitingFibers(size_t threadID);
+		void ReleaseFiber(size_t index);  // Restores availability to a fiber, marking the start of its idle period.
+		void CleanupPreviousFiber(Fiber& fiber, size_t threadID);  // Releases the fiber that scheduled us, or moves it to the wait pool if it suspended.
+
+		// Moves the calling job's fiber to the wait pool and runs another fiber on this worker. Returns once a worker resumes us, which may not be this one.
+		void Suspend();
+
+		// Parks the calling job's fiber outside of the wait pool and runs another fiber on this worker. Once we've been switched out, that
+		// fiber calls publish with our waiter, which hands it to whoever will unpark us. Returning false from publish unparks us right away.
+		void Park(bool (*publish)(void*, FiberWaiter&), void* context);
+		void Unpark(FiberWaiter& waiter);  // Makes a parked fiber ready to resume.
+
+		void SwitchToAvailableFiber();  // Shared tail of Suspend() and Park().
+
+		// Wakes up to count workers sleeping for lack of work. Cheap when nobody sleeps, call after publishing work.
+		void WakeWorkers(size_t count);
+		bool HasWork(size_t threadID);  // Approximate, checks anything this worker could run or steal.
+		static bool ShouldSleep(const void* manager, std::uintptr_t threadID);  // Validation of a worker about to park.
+
+		void TrimFibers(std::chrono::steady_clock::duration threshold);  // Decommits the stacks of fibers idle for at least the threshold.
+		void TryTrimFibers();  // Rate limited automatic trim, called by workers before sleeping.
 	};
 
-	template <typename U>
-	void Manager::EnqueueInternal(U&& job)
+	inline void Manager::EnqueueInternal(Job&& job)
 	{
 		JOBS_SCOPED_STAT("Enqueue Internal");
 
 		// If we're a job builder, we need to increment the counter before leaving Enqueue.
 		if (job.stream)
 		{
-			job.GetCounter().operator++();  // We need to increment the counter since we might end up waiting on it immediately, before the sub jobs are enqueued. Decremented in the job builder.
+			JobBuilder::GetCounter(job)->operator++();  // We might end up waiting on the completion immediately, before the stages are enqueued. Decremented in the job builder.
 		}
 
 		auto thisThreadID{ GetThisThreadID() };
 
 		if (IsValidID(thisThreadID))
 		{
-			workers[thisThreadID].GetJobQueue().enqueue(std::forward<JobBuilder>(static_cast<JobBuilder&&>(job)));
+			workers[thisThreadID].GetJobQueue().enqueue(std::move(job));
 		}
 
 		else
@@ -130,29 +210,43 @@ namespace Jobs
 			// Note: We might lose an increment here if this runs in parallel, but we would rather suffer that instead of locking.
 			enqueueIndex.store((cachedEI + 1) % workers.size(), std::memory_order_release);
 
-			workers[cachedEI].GetJobQueue().enqueue(std::forward<JobBuilder>(static_cast<JobBuilder&&>(job)));
+			workers[cachedEI].GetJobQueue().enqueue(std::move(job));
 		}
 	}
 
 	template <typename U>
-	void Manager::Enqueue(U&& job)
+	auto Manager::Enqueue(U&& job)
 	{
-		if constexpr (!std::is_same_v<std::decay_t<U>, Job> && !std::is_same_v<std::decay_t<U>, JobBuilder>)
+		if constexpr (Detail::isJobCallable<U>)
+		{
+			Enqueue(Job{ std::forward<U>(job) });
+		}
+
+		else if constexpr (std::is_same_v<std::decay_t<U>, JobBuilder>)
+		{
+			auto completion{ JobBuilder::GetCounter(job) };  // Taken before the job is gone, it might even have finished by the time we return.
+
+			EnqueueInternal(static_cast<Job&&>(job));  // Builders have no state outside of the job, slicing is safe.
+
+			JOBS_SCOPED_STAT("Enqueue Notify");
+
+			WakeWorkers(1);
+
+			return completion;
+		}
+
+		else if constexpr (!std::is_same_v<std::decay_t<U>, Job> && !std::is_same_v<std::decay_t<U>, JobBuilder>)
 		{
 			static_assert(false, "Enqueue only supports objects of type Job");
 		}
 
 		else
 		{
-			EnqueueInternal(std::forward<JobBuilder>(static_cast<JobBuilder&&>(job)));
+			EnqueueInternal(std::move(job));
 
 			JOBS_SCOPED_STAT("Enqueue Notify");
 
-			// #NOTE: Safeguarding the notify can destroy performance in high enqueue situations. This leaves a blind spot potential,
-			// but the risk is worth it. Even if a blind spot signal happens, the worker will just sleep until a new enqueue arrives, where it can recover.
-			//queueCV.Lock();
-			queueCV.NotifyOne();  // Notify one sleeper. They will work steal if they don't get the job enqueued directly.
-			//queueCV.Unlock();
+			WakeWorkers(1);  // Wake one sleeper. They will work steal if they don't get the job enqueued directly.
 		}
 	}
 
@@ -161,20 +255,25 @@ namespace Jobs
 	{
 		for (auto iter = 0; iter < Size; ++iter)
 		{
-			EnqueueInternal(jobs[iter]);
+			EnqueueInternal(std::move(jobs[iter]));
 		}
 
-		queueCV.NotifyAll();  // Notify all sleepers.
+		WakeWorkers(std::numeric_limits<size_t>::max());  // Wake all sleepers.
 	}
 
 	template <typename U>
-	void Manager::Enqueue(U&& job, const std::shared_ptr<Counter<>>& counter)
+	void Manager::Enqueue(U&& job, const CounterHandle<>& counter)
 	{
 		if constexpr (std::is_same_v<std::decay_t<U>, JobBuilder>)
 		{
 			static_assert(false, "Cannot enqueue a JobBuilder with a custom counter");
 		}
 
+		else if constexpr (Detail::isJobCallable<U>)
+		{
+			Enqueue(Job{ std::forward<U>(job) }, counter);
+		}
+
 		else if constexpr (!std::is_same_v<std::decay_t<U>, Job>)
 		{
 			static_assert(false, "Enqueue only supports objects of type Job");
@@ -182,28 +281,46 @@ namespace Jobs
 
 		else
 		{
-			counter->operator++();
-			job.atomicCounter = counter;
+			job.counterShard = static_cast<std::uint32_t>(counter->Arrive());
+			job.counter = counter;
 
 			Enqueue(job);
 		}
 	}
 
 	template <size_t Size>
-	void Manager::Enqueue(Job (&jobs)[Size], const std::shared_ptr<Counter<>>& counter)
+	void Manager::Enqueue(Job (&jobs)[Size], const CounterHandle<>& counter)
 	{
-		counter->operator+=(Size);
-
 		for (auto iter = 0; iter < Size; ++iter)
 		{
-			jobs[iter].atomicCounter = counter;
+			jobs[iter].counterShard = static_cast<std::uint32_t>(counter->Arrive());  // Each job arrives separately, so sharded counters spread them out.
+			jobs[iter].counter = counter;
 		}
 
 		Enqueue(jobs);
 	}
 
 	template <typename U>
-	std::shared_ptr<Counter<>> Manager::Enqueue(U&& job, const std::string& group)
+	JobHandle Manager::EnqueueTracked(U&& job)
+	{
+		if constexpr (std::is_same_v<std::decay_t<U>, JobBuilder>)
+		{
+			static_assert(false, "Cannot track a JobBuilder, use the completion handle it returns instead");
+		}
+
+		else
+		{
+			auto& slot{ jobSlots.Acquire() };
+			const JobHandle handle{ jobSlots, slot };
+
+			Enqueue(std::forward<U>(job), CounterHandle<>{ static_cast<Counter<>&>(slot) });
+
+			return handle;
+		}
+	}
+
+	template <typename U>
+	CounterHandle<> Manager::Enqueue(U&& job, const std::string& group)
 	{
 		if constexpr (!std::is_same_v<std::decay_t<U>, Job> && !std::is_same_v<std::decay_t<U>, JobBuilder>)
 		{
@@ -212,9 +329,9 @@ namespace Jobs
 
 		else
 		{
-			std::shared_ptr<Counter<>> groupCounter;
+			CounterHandle<> groupCounter;
 
-			auto allocateCounter{ []() { return std::make_shared<Counter<>>(1); } };
+			auto allocateCounter{ []() { return MakeCounter(1); } };
 
 			if (group.empty())
 			{
@@ -238,7 +355,7 @@ namespace Jobs
 				}
 			}
 
-			job.atomicCounter = groupCounter;
+			job.counter = groupCounter;
 			Enqueue(job);
 
 			return groupCounter;
@@ -246,11 +363,11 @@ namespace Jobs
 	}
 
 	template <size_t Size>
-	std::shared_ptr<Counter<>> Manager::Enqueue(Job (&jobs)[Size], const std::string& group)
+	CounterHandle<> Manager::Enqueue(Job (&jobs)[Size], const std::string& group)
 	{
-		std::shared_ptr<Counter<>> groupCounter;
+		CounterHandle<> groupCounter;
 
-		auto allocateCounter{ []() { return std::make_shared<Counter<>>(1); } };
+		auto allocateCounter{ []() { return MakeCounter(1); } };
 
 		if (group.empty())
 		{
@@ -276,7 +393,7 @@ namespace Jobs
 
 		for (auto iter = 0; iter < Size; ++iter)
 		{
-			jobs[iter].atomicCounter = groupCounter;
+			jobs[iter].counter = groupCounter;
 		}
 
 		Enqueue(jobs);
@@ -284,6 +401,14 @@ namespace Jobs
 		return groupCounter;
 	}
 
+	template <typename T, typename... Arguments>
+	T* Manager::NewFrame(Arguments&&... arguments)
+	{
+		static_assert(std::is_trivially_destructible_v<T>, "Frame allocations are released without running destructors.");
+
+		return new (AllocateFrame(sizeof(T), alignof(T))) T{ std::forward<Arguments>(arguments)... };
+	}
+
 	bool Manager::IsValidID(size_t id) const
 	{
 		return id != invalidID;
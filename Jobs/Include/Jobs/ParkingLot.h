@@ -0,0 +1,63 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <Jobs/Fiber.h>
+
+#include <cstddef>  // std::size_t
+#include <cstdint>  // std::uintptr_t
+#include <limits>  // std::numeric_limits
+
+namespace Jobs
+{
+	// Global table of wait queues keyed by address, so that a synchronization primitive only needs the word it synchronizes on.
+	// Jobs park their fiber, any other thread blocks. Validation runs under the queue lock right before parking, so an unpark
+	// that follows a change to the word the validation reads can't be missed.
+	class ParkingLot
+	{
+	public:
+		// Returns true to go ahead with parking. Receives the context and the value given to Park().
+		using ValidateType = bool(*)(const void*, std::uintptr_t);
+
+		// Runs under the queue lock while unparking a single waiter, the result is handed to the waiter as its token.
+		using UnparkCallbackType = std::uintptr_t(*)(void*, bool unparked, bool mayHaveMore);
+
+		struct ParkResult
+		{
+			bool unparked = false;  // False if the validation failed and we never parked.
+			std::uintptr_t token = 0;  // Passed by the waker.
+		};
+
+	public:
+		ParkingLot() = delete;
+
+		// Blocking operation. The context must outlive the park, it's read after a parking fiber has been switched out.
+		static ParkResult Park(const void* address, ValidateType validate, const void* context, std::uintptr_t value = 0);
+
+		// Always blocks the calling thread, even from inside of a job. Reserved for workers that have nothing left to run.
+		static ParkResult ParkThread(const void* address, ValidateType validate, const void* context, std::uintptr_t value = 0);
+
+		// Queues a waiter without blocking anyone, its resume callback runs on the waker's thread once unparked. Returns false instead if
+		// the validation failed. The waiter must stay put until it's resumed.
+		static bool ParkAsync(FiberWaiter& waiter);
+
+		// Returns the amount of waiters unparked.
+		static size_t Unpark(const void* address, size_t count, std::uintptr_t token = 0);
+		static size_t UnparkOne(const void* address) { return Unpark(address, 1); }
+		static size_t UnparkAll(const void* address) { return Unpark(address, std::numeric_limits<size_t>::max()); }
+
+		// Lets the waker decide on the token while the queue is locked, knowing whether anyone is left behind. Returns true if a waiter was unparked.
+		static bool UnparkOne(const void* address, UnparkCallbackType callback, void* context);
+
+		// Sequentially consistent, pairs with parking. A change to a word followed by this check either sees the waiter, or the
+		// waiter's validation sees the change. Shared by every address that maps to the same queue, so it can report false positives.
+		static bool MayHaveParked(const void* address);
+
+	private:
+		static bool Publish(void*, FiberWaiter& waiter);
+
+		static bool Enqueue(FiberWaiter& waiter);  // Returns false instead if the validation failed.
+		static void Wake(FiberWaiter& waiter, std::uintptr_t token);
+		static ParkResult Block(FiberWaiter& waiter);
+	};
+}
@@ -13,4 +13,37 @@
 #endif
 #ifndef JOBS_PLATFORM_POSIX
   #define JOBS_PLATFORM_POSIX 0
-#endif
\ No newline at end of file
+#endif
+
+#if JOBS_PLATFORM_WINDOWS
+  #define JOBS_NOINLINE __declspec(noinline)
+#else
+  #define JOBS_NOINLINE __attribute__((noinline))
+#endif
+
+// Spin-wait hint, lets the core know we're busy waiting on another one.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+  #include <immintrin.h>
+  #define JOBS_CPU_RELAX() _mm_pause()
+#elif defined(_M_ARM64)
+  #include <intrin.h>
+  #define JOBS_CPU_RELAX() __yield()
+#elif defined(__aarch64__)
+  #define JOBS_CPU_RELAX() __asm__ __volatile__("yield")
+#else
+  #define JOBS_CPU_RELAX() do {} while (0)
+#endif
+
+#include <new>  // std::hardware_destructive_interference_size
+
+namespace Jobs
+{
+	namespace Detail
+	{
+#ifdef __cpp_lib_hardware_interference_size
+		constexpr auto hardwareDestructiveInterference = std::hardware_destructive_interference_size;
+#else
+		constexpr auto hardwareDestructiveInterference = 64;
+#endif
+	}
+}
\ No newline at end of file
@@ -2,15 +2,50 @@
 
 #pragma once
 
-#include <atomic>  // std::atomic_flag
+#include <Jobs/Platform.h>
+
+#include <atomic>  // std::atomic
 #include <thread>  // std::this_thread
 
 namespace Jobs
 {
+	namespace Detail
+	{
+		// Exponential backoff for contended spinning, pausing twice as long each round. Once the limit is reached we give up our
+		// time slice instead, the holder might not be running.
+		class Backoff
+		{
+			static constexpr unsigned int maxPauses = 64;
+
+		private:
+			unsigned int pauses = 1;
+
+		public:
+			void operator()()
+			{
+				if (pauses <= maxPauses)
+				{
+					for (unsigned int iter{ 0 }; iter < pauses; ++iter)
+					{
+						JOBS_CPU_RELAX();
+					}
+
+					pauses <<= 1;
+				}
+
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+		};
+	}
+
+	// Test and test-and-set lock. Unfair, but the cheapest to take when uncontended or lightly contended.
 	class Spinlock
 	{
 	private:
-		std::atomic_flag status = ATOMIC_FLAG_INIT;
+		std::atomic_bool status{ false };
 
 	public:
 		Spinlock() = default;
@@ -27,19 +62,170 @@ namespace Jobs
 
 	void Spinlock::Lock()
 	{
-		while (status.test_and_set(std::memory_order_acquire))[[unlikely]]
+		while (status.exchange(true, std::memory_order_acquire))[[unlikely]]
 		{
-			std::this_thread::yield();
+			Detail::Backoff backoff;
+
+			// Wait on a shared copy of the line, only write once the lock looks free.
+			while (status.load(std::memory_order_relaxed))
+			{
+				backoff();
+			}
 		}
 	}
 
 	bool Spinlock::TryLock()
 	{
-		return !status.test_and_set(std::memory_order_acquire);
+		return !status.load(std::memory_order_relaxed) && !status.exchange(true, std::memory_order_acquire);
 	}
 
 	void Spinlock::Unlock()
 	{
-		status.clear(std::memory_order_release);
+		status.store(false, std::memory_order_release);
+	}
+
+	// First come first served lock. Every waiter spins on the same line, which gets expensive with many waiters.
+	class TicketSpinlock
+	{
+	private:
+		std::atomic<unsigned int> next{ 0 };
+		std::atomic<unsigned int> serving{ 0 };
+
+	public:
+		TicketSpinlock() = default;
+		TicketSpinlock(const TicketSpinlock&) = delete;
+		TicketSpinlock(TicketSpinlock&&) noexcept = delete;
+
+		TicketSpinlock& operator=(const TicketSpinlock&) = delete;
+		TicketSpinlock& operator=(TicketSpinlock&&) noexcept = delete;
+
+		inline void Lock();
+		inline bool TryLock();
+		inline void Unlock();
+	};
+
+	void TicketSpinlock::Lock()
+	{
+		const auto ticket{ next.fetch_add(1, std::memory_order_relaxed) };
+
+		Detail::Backoff backoff;
+
+		while (serving.load(std::memory_order_acquire) != ticket)
+		{
+			backoff();
+		}
+	}
+
+	bool TicketSpinlock::TryLock()
+	{
+		auto current{ serving.load(std::memory_order_relaxed) };
+
+		// Only take a ticket if it would be served right away.
+		return next.compare_exchange_strong(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed);
+	}
+
+	void TicketSpinlock::Unlock()
+	{
+		// Only the holder writes this, no need for a read-modify-write.
+		serving.store(serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Queue lock, each waiter spins on its own node and the holder hands the lock to its successor directly. Fair, and contended
+	// waiters don't touch any shared line, at the cost of a node per acquisition. Nodes must stay put until unlocked.
+	class McsSpinlock
+	{
+	public:
+		struct alignas(Detail::hardwareDestructiveInterference) Node
+		{
+			std::atomic<Node*> next{ nullptr };
+			std::atomic_bool locked{ false };
+		};
+
+		// Scoped acquisition with its own node.
+		class Guard
+		{
+		private:
+			McsSpinlock& lock;
+			Node node;
+
+		public:
+			Guard(McsSpinlock& inLock) : lock(inLock) { lock.Lock(node); }
+			~Guard() { lock.Unlock(node); }
+
+			Guard(const Guard&) = delete;
+			Guard(Guard&&) noexcept = delete;
+
+			Guard& operator=(const Guard&) = delete;
+			Guard& operator=(Guard&&) noexcept = delete;
+		};
+
+	private:
+		std::atomic<Node*> tail{ nullptr };
+
+	public:
+		McsSpinlock() = default;
+		McsSpinlock(const McsSpinlock&) = delete;
+		McsSpinlock(McsSpinlock&&) noexcept = delete;
+
+		McsSpinlock& operator=(const McsSpinlock&) = delete;
+		McsSpinlock& operator=(McsSpinlock&&) noexcept = delete;
+
+		inline void Lock(Node& node);
+		inline bool TryLock(Node& node);
+		inline void Unlock(Node& node);
+	};
+
+	void McsSpinlock::Lock(Node& node)
+	{
+		node.next.store(nullptr, std::memory_order_relaxed);
+		node.locked.store(true, std::memory_order_relaxed);
+
+		auto* previous{ tail.exchange(&node, std::memory_order_acq_rel) };
+
+		if (!previous)
+		{
+			return;
+		}
+
+		previous->next.store(&node, std::memory_order_release);
+
+		Detail::Backoff backoff;
+
+		while (node.locked.load(std::memory_order_acquire))
+		{
+			backoff();
+		}
+	}
+
+	bool McsSpinlock::TryLock(Node& node)
+	{
+		node.next.store(nullptr, std::memory_order_relaxed);
+
+		Node* expected{ nullptr };
+
+		return tail.compare_exchange_strong(expected, &node, std::memory_order_acquire, std::memory_order_relaxed);
+	}
+
+	void McsSpinlock::Unlock(Node& node)
+	{
+		auto* successor{ node.next.load(std::memory_order_acquire) };
+
+		if (!successor)
+		{
+			// Nobody queued behind us, release the lock entirely.
+			auto* expected{ &node };
+			if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed))
+			{
+				return;
+			}
+
+			// Someone swapped themselves in as the tail but hasn't linked up to us yet.
+			while (!(successor = node.next.load(std::memory_order_acquire)))
+			{
+				JOBS_CPU_RELAX();
+			}
+		}
+
+		successor->locked.store(false, std::memory_order_release);
 	}
-}
\ No newline at end of file
+}
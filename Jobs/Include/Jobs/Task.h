@@ -0,0 +1,410 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#if !defined(__cpp_impl_coroutine)
+#error "Tasks require C++20 coroutines, generate the project with the cpp20 option."
+#endif
+
+#include <Jobs/Manager.h>
+#include <Jobs/Future.h>
+#include <Jobs/Counter.h>
+#include <Jobs/CounterHandle.h>
+#include <Jobs/FiberMutex.h>
+#include <Jobs/ParkingLot.h>
+#include <Jobs/Assert.h>
+
+#include <coroutine>  // std::coroutine_handle, std::suspend_always, std::noop_coroutine
+#include <optional>  // std::optional
+#include <utility>  // std::move, std::forward, std::exchange
+#include <exception>  // std::terminate
+
+namespace Jobs
+{
+	template <typename T = void>
+	class Task;
+
+	namespace Detail
+	{
+		// Continues a task as a new job. The task runs on whichever fiber picks it up, and only until its next suspension.
+		inline void ResumeAsJob(Manager& manager, std::coroutine_handle<> handle)
+		{
+			manager.Enqueue([handle] { handle.resume(); });
+		}
+
+		struct TaskPromiseBase
+		{
+			Manager* owner = nullptr;  // Resumes us after a wait, inherited from whoever awaits us.
+			std::coroutine_handle<> continuation;  // Awaiting task, resumed once we're done.
+			bool detached = false;  // Nobody awaits us, the frame is destroyed once we're done.
+
+			struct FinalAwaiter
+			{
+				bool await_ready() noexcept { return false; }
+
+				template <typename Promise>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+				{
+					auto& promise{ handle.promise() };
+
+					// Continue the awaiting task right here, on the same worker.
+					if (promise.continuation)
+					{
+						return promise.continuation;
+					}
+
+					if (promise.detached)
+					{
+						handle.destroy();
+					}
+
+					return std::noop_coroutine();
+				}
+
+				void await_resume() noexcept {}
+			};
+
+			// Lazily started, either by being awaited or spawned.
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			FinalAwaiter final_suspend() noexcept { return {}; }
+
+			// Release builds have exceptions disabled, same as a throwing job.
+			void unhandled_exception() noexcept { std::terminate(); }
+		};
+
+		template <typename T>
+		struct TaskPromise : TaskPromiseBase
+		{
+			std::optional<T> value;
+
+			Task<T> get_return_object() noexcept;
+
+			template <typename U>
+			void return_value(U&& result)
+			{
+				value.emplace(std::forward<U>(result));
+			}
+
+			T TakeValue()
+			{
+				return std::move(*value);
+			}
+		};
+
+		template <>
+		struct TaskPromise<void> : TaskPromiseBase
+		{
+			Task<void> get_return_object() noexcept;
+
+			void return_void() noexcept {}
+			void TakeValue() noexcept {}
+		};
+
+		// Base of awaiters waiting on the parking lot, the waiter lives in the coroutine frame for the duration of the wait.
+		struct TaskWaiter : FiberWaiter
+		{
+			Manager* manager = nullptr;
+			std::coroutine_handle<> handle;
+
+			template <typename Promise>
+			void Bind(std::coroutine_handle<Promise> inHandle)
+			{
+				manager = inHandle.promise().owner;
+				handle = inHandle;
+
+				JOBS_ASSERT(manager, "Awaiting outside of a spawned task.");
+			}
+		};
+
+		template <typename T>
+		struct CounterAwaiter : TaskWaiter
+		{
+			CounterHandle<T> counter;  // Keeps pooled counters alive while we wait.
+			T expectedValue;
+
+			CounterAwaiter(Counter<T>& inCounter, T inExpectedValue) : counter(inCounter), expectedValue(inExpectedValue) {}
+
+			bool await_ready()
+			{
+				return counter->Evaluate(expectedValue);
+			}
+
+			template <typename Promise>
+			bool await_suspend(std::coroutine_handle<Promise> inHandle)
+			{
+				Bind(inHandle);
+
+				counter->RegisterWaiter(expectedValue);
+
+				if (Park())
+				{
+					return true;
+				}
+
+				counter->UnregisterWaiter();
+
+				return false;  // Satisfied in the meantime, carry on.
+			}
+
+			void await_resume() noexcept {}
+
+			bool Park()
+			{
+				address = &counter->internalValue;
+				validate = &Counter<T>::ShouldPark;
+				context = counter.Get();
+				value = static_cast<std::uintptr_t>(expectedValue);
+				resume = &CounterAwaiter::Resume;
+
+				return ParkingLot::ParkAsync(*this);
+			}
+
+			static void Resume(FiberWaiter& waiter)
+			{
+				auto& self{ static_cast<CounterAwaiter&>(waiter) };
+
+				// Every notify wakes all of the waiters, only some of them might be satisfied. Checked from a job, not on the waker's thread.
+				self.manager->Enqueue([&self]
+				{
+					if (!self.counter->Evaluate(self.expectedValue) && self.Park())
+					{
+						return;
+					}
+
+					self.counter->UnregisterWaiter();
+					self.handle.resume();
+				});
+			}
+		};
+
+		struct MutexAwaiter : TaskWaiter
+		{
+			FiberMutex& mutex;
+
+			MutexAwaiter(FiberMutex& inMutex) : mutex(inMutex) {}
+
+			bool await_ready()
+			{
+				return mutex.try_lock();
+			}
+
+			template <typename Promise>
+			bool await_suspend(std::coroutine_handle<Promise> inHandle)
+			{
+				Bind(inHandle);
+
+				return !Acquire();
+			}
+
+			void await_resume() noexcept {}
+
+			// Mirrors FiberMutex::LockSlow() without the spinning. Returns true once we own the mutex, false if we parked.
+			bool Acquire()
+			{
+				while (true)
+				{
+					auto current{ mutex.state.load(std::memory_order_relaxed) };
+
+					if (!(current & FiberMutex::locked))
+					{
+						if (mutex.state.compare_exchange_weak(current, current | FiberMutex::locked, std::memory_order_acquire, std::memory_order_relaxed))
+						{
+							return true;
+						}
+
+						continue;
+					}
+
+					if (!(current & FiberMutex::parked) && !mutex.state.compare_exchange_weak(current, current | FiberMutex::parked, std::memory_order_relaxed, std::memory_order_relaxed))
+					{
+						continue;
+					}
+
+					address = &mutex.state;
+					validate = &FiberMutex::ShouldPark;
+					context = &mutex;
+					value = 0;
+					resume = &MutexAwaiter::Resume;
+
+					if (ParkingLot::ParkAsync(*this))
+					{
+						return false;
+					}
+				}
+			}
+
+			static void Resume(FiberWaiter& waiter)
+			{
+				auto& self{ static_cast<MutexAwaiter&>(waiter) };
+
+				// Handed over by the previous holder, we own the mutex already.
+				if (waiter.value == FiberMutex::handOffToken)
+				{
+					ResumeAsJob(*self.manager, self.handle);
+
+					return;
+				}
+
+				self.manager->Enqueue([&self]
+				{
+					if (self.Acquire())
+					{
+						self.handle.resume();
+					}
+				});
+			}
+		};
+
+		template <typename T>
+		struct TaskAwaiter
+		{
+			std::coroutine_handle<TaskPromise<T>> child;
+
+			bool await_ready() noexcept { return false; }
+
+			template <typename Promise>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> awaiting) noexcept
+			{
+				auto& promise{ child.promise() };
+				promise.owner = awaiting.promise().owner;
+				promise.continuation = awaiting;
+
+				return child;  // Symmetric transfer, the child runs without growing the stack.
+			}
+
+			T await_resume()
+			{
+				return child.promise().TakeValue();
+			}
+		};
+
+		template <typename T>
+		Task<void> SpawnRoot(Task<T> task, Promise<T> promise);
+	}
+
+	// Stackless alternative to a job, for work that mostly waits. Runs on the workers like any job, but a suspended task only holds on
+	// to its coroutine frame instead of a fiber. Awaiting a child task runs it right away on the same worker. Tasks are started with
+	// Spawn(), or by being awaited from another task. Blocking calls inside of a task park the fiber as usual, prefer the awaitables.
+	template <typename T>
+	class Task
+	{
+		friend struct Detail::TaskPromise<T>;
+
+		template <typename U>
+		friend Future<U> Spawn(Manager& manager, Task<U> task);
+
+	public:
+		using promise_type = Detail::TaskPromise<T>;
+
+	private:
+		std::coroutine_handle<promise_type> handle;
+
+		explicit Task(std::coroutine_handle<promise_type> inHandle) : handle(inHandle) {}
+
+	public:
+		Task() = default;
+		Task(const Task&) = delete;
+		Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+		~Task()
+		{
+			if (handle)
+			{
+				handle.destroy();
+			}
+		}
+
+		Task& operator=(const Task&) = delete;
+		Task& operator=(Task&& other) noexcept
+		{
+			if (this != &other)
+			{
+				if (handle)
+				{
+					handle.destroy();
+				}
+
+				handle = std::exchange(other.handle, nullptr);
+			}
+
+			return *this;
+		}
+
+		Detail::TaskAwaiter<T> operator co_await() noexcept
+		{
+			JOBS_ASSERT(handle, "Awaiting an empty task.");
+
+			return { handle };
+		}
+
+		explicit operator bool() const { return static_cast<bool>(handle); }
+	};
+
+	// Starts the task as a job, the future becomes ready once the task has finished.
+	template <typename T>
+	Future<T> Spawn(Manager& manager, Task<T> task)
+	{
+		Promise<T> promise{ manager };
+		auto future{ promise.GetFuture() };
+
+		auto root{ Detail::SpawnRoot(std::move(task), std::move(promise)) };
+		auto handle{ std::exchange(root.handle, nullptr) };
+
+		handle.promise().owner = &manager;
+		handle.promise().detached = true;
+
+		Detail::ResumeAsJob(manager, handle);
+
+		return future;
+	}
+
+	// Awaitables, only for use inside of tasks.
+
+	// Suspends the task until the counter reaches the expected value.
+	template <typename T>
+	Detail::CounterAwaiter<T> WaitAsync(Counter<T>& counter, T expectedValue = T{ 0 })
+	{
+		return { counter, expectedValue };
+	}
+
+	template <typename T>
+	Detail::CounterAwaiter<T> WaitAsync(const CounterHandle<T>& counter, T expectedValue = T{ 0 })
+	{
+		return { *counter, expectedValue };
+	}
+
+	// Suspends the task until the mutex is ours, release it with unlock() as usual.
+	inline Detail::MutexAwaiter LockAsync(FiberMutex& mutex)
+	{
+		return { mutex };
+	}
+
+	namespace Detail
+	{
+		template <typename T>
+		Task<T> TaskPromise<T>::get_return_object() noexcept
+		{
+			return Task<T>{ std::coroutine_handle<TaskPromise>::from_promise(*this) };
+		}
+
+		inline Task<void> TaskPromise<void>::get_return_object() noexcept
+		{
+			return Task<void>{ std::coroutine_handle<TaskPromise>::from_promise(*this) };
+		}
+
+		template <typename T>
+		Task<void> SpawnRoot(Task<T> task, Promise<T> promise)
+		{
+			if constexpr (std::is_void_v<T>)
+			{
+				co_await task;
+				promise.SetValue();
+			}
+
+			else
+			{
+				promise.SetValue(co_await task);
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#pragma once
+
+#include <Jobs/CounterHandle.h>
+
+#include <vector>  // std::vector
+#include <initializer_list>  // std::initializer_list
+#include <cstddef>  // std::size_t
+
+namespace Jobs
+{
+	namespace Detail
+	{
+		class MultiWait
+		{
+		public:
+			// Returns the index of a satisfied counter when waiting for any, otherwise the count.
+			static size_t Wait(const CounterHandle<>* counters, size_t count, Counter<>::Type expectedValue, bool any);
+		};
+	}
+
+	// Blocking operations. We block once for the whole set rather than once per counter. From a job, only the fiber is parked and the
+	// worker moves on to other work.
+
+	// Waits until every counter has reached the expected value.
+	inline void WaitAll(std::initializer_list<CounterHandle<>> counters, Counter<>::Type expectedValue = Counter<>::Type{ 0 })
+	{
+		Detail::MultiWait::Wait(counters.begin(), counters.size(), expectedValue, false);
+	}
+
+	inline void WaitAll(const std::vector<CounterHandle<>>& counters, Counter<>::Type expectedValue = Counter<>::Type{ 0 })
+	{
+		Detail::MultiWait::Wait(counters.data(), counters.size(), expectedValue, false);
+	}
+
+	// Waits until at least one counter has reached the expected value, returns the index of that counter.
+	inline size_t WaitAny(std::initializer_list<CounterHandle<>> counters, Counter<>::Type expectedValue = Counter<>::Type{ 0 })
+	{
+		return Detail::MultiWait::Wait(counters.begin(), counters.size(), expectedValue, true);
+	}
+
+	inline size_t WaitAny(const std::vector<CounterHandle<>>& counters, Counter<>::Type expectedValue = Counter<>::Type{ 0 })
+	{
+		return Detail::MultiWait::Wait(counters.data(), counters.size(), expectedValue, true);
+	}
+}
@@ -3,7 +3,7 @@
 #pragma once
 
 #include "../../ThirdParty/ConcurrentQueue/concurrentqueue.h"
-#include <Jobs/JobBuilder.h>
+#include <Jobs/Job.h>
 
 #include <cstddef>  // std::size_t
 #include <thread>  // std::thread
@@ -13,6 +13,7 @@ namespace Jobs
 {
 	class Manager;
 	class Fiber;
+	class SharedStack;
 
 	class Worker
 	{
@@ -24,7 +25,10 @@ namespace Jobs
 		size_t id;  // Manager-specific ID.
 
 		Fiber* threadFiber = nullptr;
-		moodycamel::ConcurrentQueue<JobBuilder> jobQueue;
+		SharedStack* sharedStack = nullptr;  // Only used with copy-stack fibers.
+		moodycamel::ConcurrentQueue<Job> jobQueue;
+		moodycamel::ConcurrentQueue<size_t> readyFibers;  // Fiber indices that suspended on this worker. Preferably resumed here, stolen when we're busy.
+		moodycamel::ConcurrentQueue<size_t> pinnedFibers;  // Fiber indices that suspended on this worker and must resume here, never stolen.
 
 		static constexpr size_t invalidFiberIndex = std::numeric_limits<size_t>::max();
 
@@ -49,7 +53,10 @@ namespace Jobs
 		size_t GetID() const { return id; }
 
 		Fiber& GetThreadFiber() const { return *threadFiber; }
-		moodycamel::ConcurrentQueue<JobBuilder>& GetJobQueue() { return jobQueue; }
+		SharedStack& GetSharedStack() const { return *sharedStack; }
+		moodycamel::ConcurrentQueue<Job>& GetJobQueue() { return jobQueue; }
+		moodycamel::ConcurrentQueue<size_t>& GetReadyFiberQueue() { return readyFibers; }
+		moodycamel::ConcurrentQueue<size_t>& GetPinnedFiberQueue() { return pinnedFibers; }
 
 		constexpr bool IsValidFiberIndex(size_t index) const { return index != invalidFiberIndex; }
 
@@ -0,0 +1,273 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#include <Jobs/Allocator.h>
+
+#include <Jobs/Spinlock.h>
+#include <Jobs/Platform.h>
+
+#include <atomic>  // std::atomic
+#include <cstddef>  // std::byte
+#include <cstdint>  // std::uintptr_t
+
+namespace Jobs
+{
+	namespace Detail
+	{
+		namespace
+		{
+			constexpr size_t slabSize = 64 * 1024;  // Slabs are aligned to their size, so a block finds its slab by masking its address.
+
+			struct Heap;
+
+			struct Slab
+			{
+				Heap* owner;
+				size_t sizeClass;
+			};
+
+			static_assert(sizeof(Slab) <= smallObjectAlignment, "The slab header must fit in front of the first block.");
+
+			struct Block
+			{
+				Block* next;
+			};
+
+			// Blocks freed by other threads, kept on their own cache line so that those frees don't contend with the owner's local lists.
+			struct alignas(hardwareDestructiveInterference) RemoteList
+			{
+				std::atomic<Block*> head{ nullptr };
+			};
+
+			// Caches of a single thread. Only the owning thread touches the local lists and the slab being carved, everyone else pushes on
+			// the remote lists. Heaps are never destroyed, so a block can always find its way back, even after the owner exited.
+			struct Heap
+			{
+				Block* local[sizeClassCount]{};
+				std::byte* carve[sizeClassCount]{};  // Unused tail of the newest slab of each class, carved up on demand.
+				std::byte* carveEnd[sizeClassCount]{};
+				RemoteList remote[sizeClassCount];
+
+				Heap* nextAbandoned = nullptr;
+
+				void* Refill(size_t sizeClass);
+				void* AllocateFromSlab(size_t sizeClass);
+			};
+
+			// Heaps of exited threads, adopted by the next thread that needs one. Their remote lists keep collecting frees in the meantime.
+			struct Shared
+			{
+				Spinlock lock;
+				Heap* abandoned = nullptr;
+			};
+
+			Shared& GetShared()
+			{
+				static auto* shared{ new Shared{} };  // Never destroyed, see above.
+
+				return *shared;
+			}
+
+			void Abandon(Heap* heap)
+			{
+				auto& shared{ GetShared() };
+
+				shared.lock.Lock();
+				heap->nextAbandoned = shared.abandoned;
+				shared.abandoned = heap;
+				shared.lock.Unlock();
+			}
+
+			// Takes an abandoned heap, or makes a new one.
+			Heap* Adopt()
+			{
+				auto& shared{ GetShared() };
+
+				shared.lock.Lock();
+				auto* heap{ shared.abandoned };
+				if (heap)
+				{
+					shared.abandoned = heap->nextAbandoned;
+				}
+
+				shared.lock.Unlock();
+
+				return heap ? heap : new Heap{};
+			}
+
+			thread_local Heap* threadHeap = nullptr;
+			thread_local bool threadExited = false;
+
+			// Returns the heap to the abandoned list once the thread exits. Kept apart from the heap pointer, which stays trivially
+			// destructible so that frees from later destructors on this thread can still read it.
+			struct HeapReleaser
+			{
+				bool registered = false;
+
+				~HeapReleaser()
+				{
+					if (threadHeap)
+					{
+						Abandon(threadHeap);
+						threadHeap = nullptr;
+					}
+
+					threadExited = true;
+				}
+			};
+
+			thread_local HeapReleaser heapReleaser;
+
+			// Never inline, fibers migrate between threads so the address of the thread local must not be cached across a suspension.
+			JOBS_NOINLINE Heap* GetThreadHeap()
+			{
+				return threadHeap;
+			}
+
+			JOBS_NOINLINE Heap* AcquireThreadHeap()
+			{
+				// Too late to register a releaser, allocations from here on borrow a heap instead.
+				if (threadExited)
+				{
+					return nullptr;
+				}
+
+				heapReleaser.registered = true;
+				threadHeap = Adopt();
+
+				return threadHeap;
+			}
+
+			void* Heap::Refill(size_t sizeClass)
+			{
+				// Take back everything other threads freed since we last looked.
+				if (auto* block{ remote[sizeClass].head.exchange(nullptr, std::memory_order_acquire) })
+				{
+					local[sizeClass] = block->next;
+
+					return block;
+				}
+
+				return AllocateFromSlab(sizeClass);
+			}
+
+			void* Heap::AllocateFromSlab(size_t sizeClass)
+			{
+				const auto size{ sizeClasses[sizeClass] };
+
+				if (static_cast<size_t>(carveEnd[sizeClass] - carve[sizeClass]) < size)
+				{
+					// Slabs live for the whole process, a thread's freed blocks stay in its caches for reuse.
+					auto* memory{ static_cast<std::byte*>(::operator new(slabSize, std::align_val_t{ slabSize })) };
+					new (memory) Slab{ this, sizeClass };
+
+					carve[sizeClass] = memory + smallObjectAlignment;
+					carveEnd[sizeClass] = memory + slabSize;
+				}
+
+				auto* result{ carve[sizeClass] };
+				carve[sizeClass] += size;
+
+				return result;
+			}
+
+			// For threads past their thread local destructors. Rare enough that an abandoned heap can be used under the lock.
+			void* AllocateBorrowed(size_t sizeClass)
+			{
+				auto* heap{ Adopt() };
+
+				void* result;
+				if (auto* block{ heap->local[sizeClass] })
+				{
+					heap->local[sizeClass] = block->next;
+					result = block;
+				}
+
+				else
+				{
+					result = heap->Refill(sizeClass);
+				}
+
+				Abandon(heap);
+
+				return result;
+			}
+
+			class SmallObjectResource final : public std::pmr::memory_resource
+			{
+				void* do_allocate(size_t bytes, size_t alignment) override
+				{
+					return Allocate(bytes, alignment);
+				}
+
+				void do_deallocate(void* pointer, size_t bytes, size_t alignment) override
+				{
+					Free(pointer, bytes, alignment);
+				}
+
+				bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+				{
+					return this == &other;
+				}
+			};
+		}
+
+		void* AllocateSmall(size_t sizeClass)
+		{
+			auto* heap{ GetThreadHeap() };
+
+			if (!heap) [[unlikely]]
+			{
+				heap = AcquireThreadHeap();
+
+				if (!heap)
+				{
+					return AllocateBorrowed(sizeClass);
+				}
+			}
+
+			auto* block{ heap->local[sizeClass] };
+
+			if (!block) [[unlikely]]
+			{
+				return heap->Refill(sizeClass);
+			}
+
+			heap->local[sizeClass] = block->next;
+
+			return block;
+		}
+
+		void FreeSmall(void* pointer)
+		{
+			auto* slab{ reinterpret_cast<Slab*>(reinterpret_cast<std::uintptr_t>(pointer) & ~(slabSize - 1)) };
+			auto* block{ static_cast<Block*>(pointer) };
+			auto* heap{ slab->owner };
+
+			if (heap == GetThreadHeap())
+			{
+				block->next = heap->local[slab->sizeClass];
+				heap->local[slab->sizeClass] = block;
+
+				return;
+			}
+
+			// Someone else's block, the owner picks it up the next time its local list of this class runs dry.
+			auto& remote{ heap->remote[slab->sizeClass].head };
+			auto* head{ remote.load(std::memory_order_relaxed) };
+
+			do
+			{
+				block->next = head;
+			}
+
+			while (!remote.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+		}
+	}
+
+	std::pmr::memory_resource* GetSmallObjectResource()
+	{
+		static auto* resource{ new Detail::SmallObjectResource{} };  // Never destroyed, see the declaration.
+
+		return resource;
+	}
+}
\ No newline at end of file
@@ -8,36 +8,61 @@
 #include <Jobs/Profiling.h>
 
 #include <utility>  // std::swap
+#include <atomic>  // std::atomic
+#include <cstring>  // std::memcpy
+#include <cstdlib>  // std::malloc, std::free
 
 #if JOBS_PLATFORM_WINDOWS
   #include <Jobs/WindowsMinimal.h>
 #else
   #include <unistd.h>
+  #include <sys/mman.h>
   #include <cstdlib>
 #endif
 
 namespace Jobs
 {
-	Fiber::Fiber(size_t stackSize, EntryType entry, Manager* owner) : data(reinterpret_cast<void*>(owner))
+	namespace
 	{
-		JOBS_SCOPED_STAT("Fiber Creation");
+		// Only written right before jumping into a fiber, so it always names the fiber running on this thread, even after migration.
+		thread_local Fiber* currentFiber = nullptr;
 
-		JOBS_LOG(LogLevel::Log, "Building fiber.");
-		JOBS_ASSERT(stackSize > 0, "Stack size must be greater than 0.");
+		std::atomic<size_t> nextLocalSlot{ 0 };
 
 		// Perform a page-aligned allocation for the stack. This is needed to allow for canary pages in overrun detection.
-
+		void* AllocateStack(size_t stackSize)
+		{
 #if JOBS_PLATFORM_WINDOWS
-		SYSTEM_INFO sysInfo{};
-		GetSystemInfo(&sysInfo);
-		const auto alignment = sysInfo.dwPageSize;
+			SYSTEM_INFO sysInfo{};
+			GetSystemInfo(&sysInfo);
+			const auto alignment = sysInfo.dwPageSize;
 
-		stack = _aligned_malloc(stackSize, alignment);
+			return _aligned_malloc(stackSize, alignment);
 #else
-		const auto alignment = getpagesize();
+			const auto alignment = getpagesize();
 
-		stack = std::aligned_alloc(alignment, stackSize);
+			return std::aligned_alloc(alignment, stackSize);
 #endif
+		}
+
+		void FreeStack(void* stack)
+		{
+#if JOBS_PLATFORM_WINDOWS
+			_aligned_free(stack);
+#else
+			std::free(stack);
+#endif
+		}
+	}
+
+	Fiber::Fiber(size_t stackSize, EntryType entry, Manager* owner) : stackSize(stackSize), data(reinterpret_cast<void*>(owner)), entry(entry)
+	{
+		JOBS_SCOPED_STAT("Fiber Creation");
+
+		JOBS_LOG(LogLevel::Log, "Building fiber.");
+		JOBS_ASSERT(stackSize > 0, "Stack size must be greater than 0.");
+
+		stack = AllocateStack(stackSize);
 
 		void* stackTop = reinterpret_cast<std::byte*>(stack) + (stackSize * sizeof(std::byte));
 
@@ -46,6 +71,13 @@ namespace Jobs
 		JOBS_ASSERT(context, "Failed to build fiber.");
 	}
 
+	Fiber::Fiber(EntryType entry, Manager* owner) : data(reinterpret_cast<void*>(owner)), entry(entry), copyStack(true)
+	{
+		JOBS_LOG(LogLevel::Log, "Building copy-stack fiber.");
+
+		// Nothing to allocate, the context is built on the shared stack the first time we're scheduled.
+	}
+
 	Fiber::Fiber(Fiber&& other) noexcept
 	{
 		Swap(other);
@@ -53,11 +85,21 @@ namespace Jobs
 
 	Fiber::~Fiber()
 	{
-#if JOBS_PLATFORM_WINDOWS
-		_aligned_free(stack);
-#else
-		std::free(stack);
-#endif
+		for (auto& slot : localStorage)
+		{
+			if (slot.value)
+			{
+				slot.destructor(slot.value);
+			}
+		}
+
+		if (sharedStack && sharedStack->occupant == this)
+		{
+			sharedStack->occupant = nullptr;
+		}
+
+		std::free(savedStack);
+		FreeStack(stack);
 	}
 
 	Fiber& Fiber::operator=(Fiber&& other) noexcept
@@ -73,13 +115,214 @@ namespace Jobs
 
 		JOBS_LOG(LogLevel::Log, "Scheduling fiber.");
 
+		currentFiber = this;
+
+		// Copy-stack fibers need their frames moved back onto the shared stack first, unless they're still the occupant.
+		if (copyStack) [[unlikely]]
+		{
+			JOBS_ASSERT(sharedStack, "Scheduled a copy-stack fiber that isn't bound to a stack.");
+
+			if (sharedStack->occupant != this)
+			{
+				JOBS_ASSERT(!from.copyStack || from.sharedStack == sharedStack, "Copy-stack fibers cannot be scheduled across shared stacks.");
+
+				if (from.copyStack)
+				{
+					// We're running on the stack that needs to be overwritten, let the switcher perform the copies.
+					sharedStack->switchTarget = this;
+					jump_fcontext(&from.context, sharedStack->switcher.context, sharedStack);
+
+					return;
+				}
+
+				sharedStack->Occupy(*this);
+			}
+		}
+
 		jump_fcontext(&from.context, context, data);
 	}
 
+	void Fiber::Decommit()
+	{
+		JOBS_SCOPED_STAT("Fiber Decommit");
+
+		if (!stack || !context)
+		{
+			return;
+		}
+
+		// Everything above the saved context belongs to the suspended frames that we will resume into, so only the region below
+		// it can be released. Keep some slack below the context for the red zone and anything the switch routines may spill.
+		constexpr size_t liveMargin = 256;
+
+#if JOBS_PLATFORM_WINDOWS
+		SYSTEM_INFO sysInfo{};
+		GetSystemInfo(&sysInfo);
+		const size_t pageSize = sysInfo.dwPageSize;
+#else
+		const size_t pageSize = getpagesize();
+#endif
+
+		const auto liveOffset = static_cast<size_t>(reinterpret_cast<std::byte*>(context) - reinterpret_cast<std::byte*>(stack));
+		JOBS_ASSERT(liveOffset <= stackSize, "Fiber context does not lie within its stack.");
+
+		const auto releaseSize = liveOffset > liveMargin ? ((liveOffset - liveMargin) / pageSize) * pageSize : 0;  // Round down to whole pages.
+
+		if (releaseSize > 0)
+		{
+			JOBS_LOG(LogLevel::Log, "Decommitting %i bytes of fiber stack.", static_cast<int>(releaseSize));
+
+#if JOBS_PLATFORM_WINDOWS
+			// The pages stay committed, but their contents no longer need to be preserved so the system can reclaim them.
+			VirtualAlloc(stack, releaseSize, MEM_RESET, PAGE_READWRITE);
+#else
+			// Private anonymous pages will be zero-filled on the next touch.
+			madvise(stack, releaseSize, MADV_DONTNEED);
+#endif
+		}
+	}
+
 	void Fiber::Swap(Fiber& other) noexcept
 	{
 		std::swap(context, other.context);
 		std::swap(stack, other.stack);
+		std::swap(stackSize, other.stackSize);
 		std::swap(data, other.data);
+		std::swap(entry, other.entry);
+		std::swap(copyStack, other.copyStack);
+		std::swap(sharedStack, other.sharedStack);
+		std::swap(savedStack, other.savedStack);
+		std::swap(savedStackSize, other.savedStackSize);
+		std::swap(savedStackCapacity, other.savedStackCapacity);
+		std::swap(localStorage, other.localStorage);
+	}
+
+	void Fiber::Bind(SharedStack& inStack)
+	{
+		JOBS_ASSERT(copyStack, "Only copy-stack fibers can be bound to a shared stack.");
+		JOBS_ASSERT(!sharedStack || sharedStack == &inStack, "Copy-stack fiber is already bound to a different stack.");
+
+		sharedStack = &inStack;
+	}
+
+	void Fiber::Reset()
+	{
+		JOBS_ASSERT(copyStack, "Only copy-stack fibers can be reset.");
+
+		if (sharedStack && sharedStack->occupant == this)
+		{
+			sharedStack->occupant = nullptr;
+		}
+
+		sharedStack = nullptr;
+		context = nullptr;
+
+		// Idle fibers shouldn't hold on to any memory.
+		std::free(savedStack);
+		savedStack = nullptr;
+		savedStackSize = 0;
+		savedStackCapacity = 0;
+	}
+
+	void Fiber::SaveStack()
+	{
+		JOBS_SCOPED_STAT("Fiber Save Stack");
+
+		const auto size{ static_cast<size_t>(static_cast<std::byte*>(sharedStack->GetTop()) - static_cast<std::byte*>(context)) };
+		JOBS_ASSERT(size <= sharedStack->stackSize, "Fiber context does not lie within its shared stack.");
+
+		// Keep the buffer right-sized, a fiber that suspended deep once shouldn't pin that memory forever.
+		if (size > savedStackCapacity || size < savedStackCapacity / 2)
+		{
+			std::free(savedStack);
+			savedStack = static_cast<std::byte*>(std::malloc(size));
+			savedStackCapacity = size;
+		}
+
+		std::memcpy(savedStack, context, size);
+		savedStackSize = size;
+	}
+
+	void Fiber::RestoreStack()
+	{
+		JOBS_SCOPED_STAT("Fiber Restore Stack");
+
+		if (!context)
+		{
+			// First schedule since we were built or reset, start from the entry point.
+			context = make_fcontext(sharedStack->GetTop(), sharedStack->stackSize, entry);
+
+			JOBS_ASSERT(context, "Failed to build fiber.");
+		}
+
+		else
+		{
+			JOBS_ASSERT(static_cast<std::byte*>(sharedStack->GetTop()) - savedStackSize == context, "Saved stack does not match the context.");
+
+			std::memcpy(context, savedStack, savedStackSize);
+		}
+	}
+
+	SharedStack::SharedStack(size_t inStackSize) : stackSize(inStackSize)
+	{
+		JOBS_ASSERT(stackSize > 0, "Stack size must be greater than 0.");
+
+		stack = AllocateStack(stackSize);
+
+		switcher = Fiber{ switcherStackSize, &SwitcherEntry, nullptr };
+		switcher.data = this;
+	}
+
+	SharedStack::~SharedStack()
+	{
+		if (occupant)
+		{
+			occupant->sharedStack = nullptr;  // The frames are lost, don't let the occupant reference us once we're gone.
+			occupant->context = nullptr;
+		}
+
+		FreeStack(stack);
+	}
+
+	void SharedStack::Occupy(Fiber& target)
+	{
+		if (occupant)
+		{
+			occupant->SaveStack();
+		}
+
+		target.RestoreStack();
+		occupant = &target;
+	}
+
+	void SharedStack::SwitcherEntry(void* data)
+	{
+		auto* owner{ static_cast<SharedStack*>(data) };
+
+		JOBS_ASSERT(owner, "Shared stack switcher missing owner.");
+
+		// We're resumed each time a fiber on the shared stack schedules another one, after saving its registers onto the stack.
+		while (true)
+		{
+			auto& target{ *owner->switchTarget };
+
+			owner->Occupy(target);
+
+			jump_fcontext(&owner->switcher.context, target.context, target.data);
+		}
+	}
+
+	// Never inline, the address of the thread local must not be cached across a suspension that resumes on another thread.
+	JOBS_NOINLINE Fiber* Fiber::GetCurrent()
+	{
+		return currentFiber;
+	}
+
+	size_t Fiber::AllocateLocalSlot()
+	{
+		const auto slot{ nextLocalSlot.fetch_add(1, std::memory_order_relaxed) };
+		JOBS_VERIFY(slot < localStorageSlots, "Exceeded the maximum number of fiber local storage slots.");
+
+		return slot;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,61 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#include <Jobs/FiberBarrier.h>
+
+#include <Jobs/ParkingLot.h>
+#include <Jobs/Assert.h>
+#include <Jobs/Profiling.h>
+
+size_t Jobs::FiberBarrier::arrive(std::ptrdiff_t update)
+{
+	JOBS_ASSERT(update > 0, "Arrived with a non-positive amount.");
+
+	// Nobody can finish this phase until we've arrived, so the phase can't move under us.
+	const auto arrivalPhase{ phase.load(std::memory_order_acquire) };
+
+	const auto previous{ remaining.fetch_sub(update, std::memory_order_acq_rel) };
+	JOBS_ASSERT(previous >= update, "Too many arrivals in a barrier phase.");
+
+	if (previous == update)
+	{
+		// Last to arrive, reset for the next phase before releasing the waiters.
+		remaining.store(expected.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		phase.fetch_add(1, std::memory_order_seq_cst);
+
+		if (ParkingLot::MayHaveParked(&phase))
+		{
+			ParkingLot::UnparkAll(&phase);
+		}
+	}
+
+	return arrivalPhase;
+}
+
+void Jobs::FiberBarrier::wait(size_t arrivalPhase)
+{
+	JOBS_SCOPED_STAT("Barrier Wait");
+
+	// Phases only move forward, so once we've seen it change we're done.
+	while (phase.load(std::memory_order_acquire) == arrivalPhase)
+	{
+		ParkingLot::Park(&phase, &FiberBarrier::ShouldPark, this, static_cast<std::uintptr_t>(arrivalPhase));
+	}
+}
+
+void Jobs::FiberBarrier::arrive_and_wait()
+{
+	wait(arrive());
+}
+
+void Jobs::FiberBarrier::arrive_and_drop()
+{
+	// Must come before our arrival, otherwise the last arrival could already have reset the phase with us included.
+	expected.fetch_sub(1, std::memory_order_relaxed);
+
+	(void)arrive();
+}
+
+bool Jobs::FiberBarrier::ShouldPark(const void* barrier, std::uintptr_t arrivalPhase)
+{
+	return static_cast<const FiberBarrier*>(barrier)->phase.load(std::memory_order_seq_cst) == static_cast<size_t>(arrivalPhase);
+}
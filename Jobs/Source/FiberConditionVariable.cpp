@@ -0,0 +1,44 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#include <Jobs/FiberConditionVariable.h>
+
+#include <Jobs/ParkingLot.h>
+#include <Jobs/Assert.h>
+#include <Jobs/Profiling.h>
+
+void Jobs::FiberConditionVariable::wait(std::unique_lock<FiberMutex>& lock)
+{
+	JOBS_SCOPED_STAT("Condition Variable Wait");
+	JOBS_ASSERT(lock.owns_lock(), "Waited on a condition variable without holding the lock.");
+
+	const auto waitEpoch{ epoch.load(std::memory_order_relaxed) };  // Sampled under the lock, any notify after the caller checked its condition bumps it.
+
+	lock.unlock();
+	ParkingLot::Park(&epoch, &FiberConditionVariable::ShouldPark, this, waitEpoch);
+	lock.lock();
+}
+
+void Jobs::FiberConditionVariable::notify_one()
+{
+	epoch.fetch_add(1, std::memory_order_seq_cst);
+
+	if (ParkingLot::MayHaveParked(&epoch))
+	{
+		ParkingLot::UnparkOne(&epoch);
+	}
+}
+
+void Jobs::FiberConditionVariable::notify_all()
+{
+	epoch.fetch_add(1, std::memory_order_seq_cst);
+
+	if (ParkingLot::MayHaveParked(&epoch))
+	{
+		ParkingLot::UnparkAll(&epoch);
+	}
+}
+
+bool Jobs::FiberConditionVariable::ShouldPark(const void* conditionVariable, std::uintptr_t waitEpoch)
+{
+	return static_cast<const FiberConditionVariable*>(conditionVariable)->epoch.load(std::memory_order_seq_cst) == waitEpoch;
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#include <Jobs/FiberLatch.h>
+
+#include <Jobs/ParkingLot.h>
+#include <Jobs/Assert.h>
+#include <Jobs/Profiling.h>
+
+void Jobs::FiberLatch::count_down(std::ptrdiff_t update)
+{
+	JOBS_ASSERT(update >= 0, "Counted down a negative amount.");
+
+	// Sequentially consistent, pairs with the parking lot registration.
+	const auto previous{ count.fetch_sub(update, std::memory_order_seq_cst) };
+	JOBS_ASSERT(previous >= update, "Latch counted down past zero.");
+
+	if (previous == update && ParkingLot::MayHaveParked(&count))
+	{
+		ParkingLot::UnparkAll(&count);
+	}
+}
+
+bool Jobs::FiberLatch::try_wait() const
+{
+	return count.load(std::memory_order_acquire) == 0;
+}
+
+void Jobs::FiberLatch::wait()
+{
+	JOBS_SCOPED_STAT("Latch Wait");
+
+	while (!try_wait())
+	{
+		ParkingLot::Park(&count, &FiberLatch::ShouldPark, this);
+	}
+}
+
+void Jobs::FiberLatch::arrive_and_wait(std::ptrdiff_t update)
+{
+	count_down(update);
+	wait();
+}
+
+bool Jobs::FiberLatch::ShouldPark(const void* latch, std::uintptr_t)
+{
+	return static_cast<const FiberLatch*>(latch)->count.load(std::memory_order_seq_cst) != 0;
+}
@@ -2,50 +2,108 @@
 
 #include <Jobs/FiberMutex.h>
 
-#include <Jobs/Manager.h>
-#include <Jobs/Logging.h>
+#include <Jobs/ParkingLot.h>
+#include <Jobs/Assert.h>
+#include <Jobs/Platform.h>
 
 void Jobs::FiberMutex::lock()
 {
-	if (flag.test_and_set(std::memory_order_acquire))
+	if (try_lock())
 	{
-		// Failed to acquire the lock, add a dependency to the job and enqueue this fiber as a waiter.
-		// Note that we cannot use the existing dependency system since that's used to test if jobs can
-		// execute before actually kicking them off, a mutex is used for halting the execution of a job
-		// that has already started.
+		return;  // Acquired the lock, we're good to move on.
+	}
 
-		auto& thisWorker = owner->workers[owner->GetThisThreadID()];
-		auto& thisFiber = owner->fibers[thisWorker.fiberIndex];
+	LockSlow();
+}
 
-		thisFiber.first.mutex = this;  // Set the mutex, evaluated in the fiber.
+bool Jobs::FiberMutex::try_lock()
+{
+	auto expected{ 0u };
 
-		const auto nextFiberIndex = owner->GetAvailableFiber();
-		JOBS_ASSERT(owner->IsValidID(nextFiberIndex), "Failed to retrieve an available fiber from a mutex lock.");
-		auto& nextFiber = owner->fibers[nextFiberIndex].first;
+	return state.compare_exchange_strong(expected, locked, std::memory_order_acquire, std::memory_order_relaxed);
+}
 
-		thisFiber.first.needsWaitEnqueue = true;  // We're now waiting on a mutex, so make sure we end up in the wait queue.
-		nextFiber.previousFiberIndex = thisWorker.fiberIndex;
-		thisWorker.fiberIndex = nextFiberIndex;  // Update the fiber index.
-		nextFiber.Schedule(thisFiber.first);
+void Jobs::FiberMutex::unlock()
+{
+	JOBS_ASSERT(state.load(std::memory_order_relaxed) & locked, "Mutex was unlocked without first being locked.");
 
-		// We'll return here when we have acquired the mutex (locked directly via external fiber).
+	// Fast path, nobody is parked.
+	auto expected{ locked };
+	if (state.compare_exchange_strong(expected, 0, std::memory_order_release, std::memory_order_relaxed))
+	{
+		return;
 	}
 
-	return;  // Acquired the lock, we're good to move on.
+	ParkingLot::UnparkOne(&state, &FiberMutex::HandOff, this);
 }
 
-bool Jobs::FiberMutex::try_lock()
+void Jobs::FiberMutex::LockSlow()
+{
+	// Spinning only pays off if the holder is about to leave, not when others are already lined up ahead of us.
+	for (unsigned int spins{ 0 }; spins < maxSpin; ++spins)
+	{
+		auto current{ state.load(std::memory_order_relaxed) };
+
+		if (current & parked)
+		{
+			break;
+		}
+
+		if (!(current & locked) && state.compare_exchange_weak(current, current | locked, std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			return;
+		}
+
+		JOBS_CPU_RELAX();
+	}
+
+	while (true)
+	{
+		auto current{ state.load(std::memory_order_relaxed) };
+
+		if (!(current & locked))
+		{
+			if (state.compare_exchange_weak(current, current | locked, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				return;
+			}
+
+			continue;
+		}
+
+		// Flag ourselves before parking, so that the holder's unlock takes the slow path.
+		if (!(current & parked) && !state.compare_exchange_weak(current, current | parked, std::memory_order_relaxed, std::memory_order_relaxed))
+		{
+			continue;
+		}
+
+		// Parking re-checks the word, so we can't miss an unlock that happened in the meantime.
+		if (const auto result{ ParkingLot::Park(&state, &FiberMutex::ShouldPark, this) }; result.unparked && result.token == handOffToken)
+		{
+			return;  // We return here owning the mutex, handed over by the previous holder.
+		}
+	}
+}
+
+bool Jobs::FiberMutex::ShouldPark(const void* mutex, std::uintptr_t)
 {
-	return !flag.test_and_set(std::memory_order_acquire);
+	return static_cast<const FiberMutex*>(mutex)->state.load(std::memory_order_seq_cst) == (locked | parked);
 }
 
-void Jobs::FiberMutex::unlock()
+std::uintptr_t Jobs::FiberMutex::HandOff(void* mutex, bool unparked, bool mayHaveMore)
 {
-#if __cpp_lib_atomic_flag_test
-	JOBS_ASSERT(flag.test(), "Mutex was unlocked without first being locked.");
-#endif
+	auto* typedMutex{ static_cast<FiberMutex*>(mutex) };
 
-	// We just need to clear, no need to wake any sleepers since all waiting fibers are in the wait queue.
+	// Runs under the parking lot's lock, nobody can park on us in the meantime.
+	if (unparked)
+	{
+		// Keep the lock held, ownership transfers along with the wake up.
+		typedMutex->state.store(mayHaveMore ? locked | parked : locked, std::memory_order_relaxed);
 
-	flag.clear(std::memory_order_release);
-}
\ No newline at end of file
+		return handOffToken;
+	}
+
+	typedMutex->state.store(0, std::memory_order_release);
+
+	return 0;
+}
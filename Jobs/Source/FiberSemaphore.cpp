@@ -0,0 +1,51 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#include <Jobs/FiberSemaphore.h>
+
+#include <Jobs/ParkingLot.h>
+#include <Jobs/Assert.h>
+#include <Jobs/Profiling.h>
+
+void Jobs::FiberSemaphore::acquire()
+{
+	JOBS_SCOPED_STAT("Semaphore Acquire");
+
+	// Woken callers compete for the release again.
+	while (!try_acquire())
+	{
+		ParkingLot::Park(&count, &FiberSemaphore::ShouldPark, this);
+	}
+}
+
+bool Jobs::FiberSemaphore::try_acquire()
+{
+	auto current{ count.load(std::memory_order_relaxed) };
+
+	while (current > 0)
+	{
+		if (count.compare_exchange_weak(current, current - 1, std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Jobs::FiberSemaphore::release(std::ptrdiff_t update)
+{
+	JOBS_ASSERT(update >= 0, "Released a negative amount.");
+
+	// Sequentially consistent, pairs with the parking lot registration.
+	count.fetch_add(update, std::memory_order_seq_cst);
+
+	if (ParkingLot::MayHaveParked(&count))
+	{
+		ParkingLot::Unpark(&count, static_cast<size_t>(update));
+	}
+}
+
+bool Jobs::FiberSemaphore::ShouldPark(const void* semaphore, std::uintptr_t)
+{
+	return static_cast<const FiberSemaphore*>(semaphore)->count.load(std::memory_order_seq_cst) <= 0;
+}
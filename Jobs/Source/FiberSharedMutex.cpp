@@ -0,0 +1,267 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#include <Jobs/FiberSharedMutex.h>
+
+#include <Jobs/ParkingLot.h>
+#include <Jobs/Assert.h>
+#include <Jobs/Platform.h>
+
+void Jobs::FiberSharedMutex::lock()
+{
+	for (unsigned int spins{ 0 }; spins < maxSpin; ++spins)
+	{
+		if (try_lock())
+		{
+			return;
+		}
+
+		JOBS_CPU_RELAX();
+	}
+
+	LockSlow();
+}
+
+bool Jobs::FiberSharedMutex::try_lock()
+{
+	auto expected{ 0u };
+
+	return state.compare_exchange_strong(expected, writer, std::memory_order_acquire, std::memory_order_relaxed);
+}
+
+void Jobs::FiberSharedMutex::unlock()
+{
+	JOBS_ASSERT(state.load(std::memory_order_relaxed) & writer, "Mutex was unlocked without first being locked.");
+
+	// Fast path, nobody is waiting.
+	auto expected{ writer };
+	if (state.compare_exchange_strong(expected, 0, std::memory_order_release, std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	HandOff(true);
+}
+
+void Jobs::FiberSharedMutex::lock_shared()
+{
+	for (unsigned int spins{ 0 }; spins < maxSpin; ++spins)
+	{
+		if (try_lock_shared())
+		{
+			return;
+		}
+
+		JOBS_CPU_RELAX();
+	}
+
+	LockSharedSlow();
+}
+
+bool Jobs::FiberSharedMutex::try_lock_shared()
+{
+	auto current{ state.load(std::memory_order_relaxed) };
+
+	// Writer preference, we don't cut in front of a waiting writer.
+	while (!(current & (writer | writersWaiting)))
+	{
+		if (state.compare_exchange_weak(current, current + reader, std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Jobs::FiberSharedMutex::unlock_shared()
+{
+	JOBS_ASSERT(state.load(std::memory_order_relaxed) >= reader, "Shared mutex was unlocked without first being locked.");
+
+	const auto previous{ state.fetch_sub(reader, std::memory_order_release) };
+
+	// The last reader out lets a waiting writer in. No new readers can enter while one is waiting.
+	if (previous / reader == 1 && (previous & writersWaiting))
+	{
+		HandOff(false);
+	}
+}
+
+void Jobs::FiberSharedMutex::LockSlow()
+{
+	while (true)
+	{
+		auto current{ state.load(std::memory_order_relaxed) };
+
+		// Free, a stale waiting flag doesn't stop us.
+		if (!(current & writer) && current / reader == 0)
+		{
+			if (state.compare_exchange_weak(current, current | writer, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				return;
+			}
+
+			continue;
+		}
+
+		// Flag ourselves before parking, so that the holders' unlock takes the slow path.
+		if (!(current & writersWaiting) && !state.compare_exchange_weak(current, current | writersWaiting, std::memory_order_relaxed, std::memory_order_relaxed))
+		{
+			continue;
+		}
+
+		// Parking re-checks the word, so we can't miss an unlock that happened in the meantime.
+		if (const auto result{ ParkingLot::Park(&state, &FiberSharedMutex::ShouldParkExclusive, this) }; result.unparked && result.token == handOffToken)
+		{
+			return;  // We return here holding the mutex exclusively.
+		}
+	}
+}
+
+void Jobs::FiberSharedMutex::LockSharedSlow()
+{
+	while (true)
+	{
+		auto current{ state.load(std::memory_order_relaxed) };
+
+		if (!(current & (writer | writersWaiting)))
+		{
+			if (state.compare_exchange_weak(current, current + reader, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				return;
+			}
+
+			continue;
+		}
+
+		if (!(current & readersWaiting) && !state.compare_exchange_weak(current, current | readersWaiting, std::memory_order_relaxed, std::memory_order_relaxed))
+		{
+			continue;
+		}
+
+		if (const auto result{ ParkingLot::Park(&readerGate, &FiberSharedMutex::ShouldParkShared, this) }; result.unparked && result.token == handOffToken)
+		{
+			return;  // We return here holding the mutex shared, woken along with the rest of the batch.
+		}
+	}
+}
+
+void Jobs::FiberSharedMutex::HandOff(bool exclusive)
+{
+	if (exclusive && (state.load(std::memory_order_seq_cst) & readersWaiting))
+	{
+		// Readers that queued up behind us go first, all at once. We downgrade to a shared hold while waking them, so that no writer can
+		// slip in between. Adding the difference clears the writer bit, which we know is set.
+		state.fetch_add(reader - writer, std::memory_order_acq_rel);
+
+		WakeReaders();
+		unlock_shared();
+
+		return;
+	}
+
+	// Otherwise the next writer. If there is none the mutex is released, and the readers that parked behind us have to be woken instead.
+	if (!ParkingLot::UnparkOne(&state, exclusive ? &FiberSharedMutex::HandOffFromWriter : &FiberSharedMutex::HandOffFromReaders, this)
+		&& (state.load(std::memory_order_seq_cst) & readersWaiting))
+	{
+		WakeReaders();
+	}
+}
+
+void Jobs::FiberSharedMutex::WakeReaders()
+{
+	// One at a time, each is counted as a holder before it runs. Stops early if a writer got in first, its unlock wakes the rest.
+	while (ParkingLot::UnparkOne(&readerGate, &FiberSharedMutex::HandOffToReader, this) && !(state.load(std::memory_order_relaxed) & writer));
+}
+
+bool Jobs::FiberSharedMutex::ShouldParkExclusive(const void* mutex, std::uintptr_t)
+{
+	const auto current{ static_cast<const FiberSharedMutex*>(mutex)->state.load(std::memory_order_seq_cst) };
+
+	return (current & writersWaiting) && ((current & writer) || current / reader > 0);
+}
+
+bool Jobs::FiberSharedMutex::ShouldParkShared(const void* mutex, std::uintptr_t)
+{
+	const auto current{ static_cast<const FiberSharedMutex*>(mutex)->state.load(std::memory_order_seq_cst) };
+
+	return (current & readersWaiting) && (current & (writer | writersWaiting));
+}
+
+std::uintptr_t Jobs::FiberSharedMutex::HandOffFromWriter(void* mutex, bool unparked, bool mayHaveMore)
+{
+	auto& state{ static_cast<FiberSharedMutex*>(mutex)->state };
+
+	// Waiters can still flag themselves, so the state is updated with exchanges rather than plain stores.
+	if (unparked)
+	{
+		// Keep the writer bit set, ownership transfers along with the wake up.
+		if (mayHaveMore)
+		{
+			state.fetch_or(writersWaiting, std::memory_order_relaxed);
+		}
+
+		else
+		{
+			state.fetch_and(~writersWaiting, std::memory_order_relaxed);
+		}
+
+		return handOffToken;
+	}
+
+	state.fetch_and(~(writer | writersWaiting), std::memory_order_seq_cst);
+
+	return 0;
+}
+
+std::uintptr_t Jobs::FiberSharedMutex::HandOffFromReaders(void* mutex, bool unparked, bool mayHaveMore)
+{
+	auto& state{ static_cast<FiberSharedMutex*>(mutex)->state };
+
+	if (!unparked)
+	{
+		state.fetch_and(~writersWaiting, std::memory_order_seq_cst);
+
+		return 0;
+	}
+
+	auto current{ state.load(std::memory_order_relaxed) };
+
+	// If someone took it in the meantime the writer retries, and parks again behind them.
+	while (!(current & writer) && current / reader == 0)
+	{
+		const auto next{ (mayHaveMore ? current | writersWaiting : current & ~writersWaiting) | writer };
+
+		if (state.compare_exchange_weak(current, next, std::memory_order_acq_rel, std::memory_order_relaxed))
+		{
+			return handOffToken;
+		}
+	}
+
+	return 0;
+}
+
+std::uintptr_t Jobs::FiberSharedMutex::HandOffToReader(void* mutex, bool unparked, bool mayHaveMore)
+{
+	auto& state{ static_cast<FiberSharedMutex*>(mutex)->state };
+
+	if (!unparked)
+	{
+		state.fetch_and(~readersWaiting, std::memory_order_seq_cst);
+
+		return 0;
+	}
+
+	auto current{ state.load(std::memory_order_relaxed) };
+
+	while (!(current & writer))
+	{
+		const auto next{ mayHaveMore ? current + reader : (current + reader) & ~readersWaiting };
+
+		if (state.compare_exchange_weak(current, next, std::memory_order_acq_rel, std::memory_order_relaxed))
+		{
+			return handOffToken;
+		}
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#include <Jobs/FrameArena.h>
+
+#include <Jobs/Assert.h>
+
+#include <algorithm>  // std::max
+#include <cstdint>  // std::uintptr_t
+
+namespace Jobs
+{
+	namespace Detail
+	{
+		void* FrameArena::Allocate(size_t size, size_t alignment)
+		{
+			JOBS_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0, "Frame allocations require a power of two alignment.");
+
+			while (current < chunks.size())
+			{
+				auto& chunk{ chunks[current] };
+
+				const auto base{ reinterpret_cast<std::uintptr_t>(chunk.memory.get()) };
+				const auto aligned{ (base + offset + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1) };
+
+				if (aligned + size <= base + chunk.size)
+				{
+					offset = static_cast<size_t>(aligned + size - base);
+
+					return reinterpret_cast<void*>(aligned);
+				}
+
+				// Doesn't fit, move on to the next chunk kept from a previous frame.
+				++current;
+				offset = 0;
+			}
+
+			// Out of chunks, grow. Oversized allocations get a chunk of their own.
+			auto& chunk{ chunks.emplace_back() };
+			chunk.size = std::max(chunkSize, size + alignment);
+			chunk.memory = std::make_unique<std::byte[]>(chunk.size);
+
+			current = chunks.size() - 1;
+			offset = 0;
+
+			return Allocate(size, alignment);
+		}
+
+		CounterHandle<> FrameArena::MakeCounter(Counter<>::Type initialValue)
+		{
+			auto counter{ Jobs::MakeCounter(initialValue) };
+			counters.push_back(counter);
+
+			return counter;
+		}
+
+		bool FrameArena::Reset()
+		{
+			auto settled{ true };
+
+			// Workers still notifying a counter hold their own handle to it, so dropping ours is safe at any point.
+			for (const auto& counter : counters)
+			{
+				settled &= counter->Get() == 0;
+			}
+
+			counters.clear();
+
+			current = 0;
+			offset = 0;
+
+			return settled;
+		}
+	}
+}
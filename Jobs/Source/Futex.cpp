@@ -3,6 +3,7 @@
 #include <Jobs/Futex.h>
 #include <Jobs/Platform.h>
 #include <Jobs/Profiling.h>
+#include <Jobs/Assert.h>
 
 #if JOBS_PLATFORM_WINDOWS
   #include <Jobs/WindowsMinimal.h>
@@ -12,6 +13,7 @@
   #include <sys/syscall.h>
   #include <linux/futex.h>
   #include <sys/time.h>
+  #include <cerrno>
   #include <limits>
 #endif
 
@@ -28,7 +30,15 @@ namespace Jobs
 		timeout.tv_sec = static_cast<time_t>(timeoutNs / (uint64_t)1e9);  // Whole seconds.
 		timeout.tv_nsec = static_cast<long>(timeoutNs % (uint64_t)1e9);  // Remaining nano seconds.
 
-		syscall(SYS_futex, compareAddress, FUTEX_WAIT, &address, timeoutNs > 0 ? &timeout : nullptr, nullptr, 0);
+		JOBS_ASSERT(size == sizeof(int), "Linux futexes only support 32 bit values.");
+
+		// Sleep while the address still holds the compared value. A mismatch or an interruption counts as a change, callers re-evaluate anyway.
+		if (syscall(SYS_futex, address, FUTEX_WAIT, *static_cast<const int*>(compareAddress), timeoutNs > 0 ? &timeout : nullptr, nullptr, 0) == -1)
+		{
+			return errno != ETIMEDOUT;
+		}
+
+		return true;
 #endif
 	}
 
@@ -6,33 +6,45 @@
 
 namespace Jobs
 {
-	void JobBuilder::operator()(Manager* owner)
+	namespace Detail
+	{
+		void JobTreeDeleter::operator()(JobTree* tree) const
+		{
+			tree->~JobTree();
+			JobTreePool::Free(tree);
+		}
+	}
+
+	void JobBuilder::Execute(Job& job, Manager* owner)
 	{
 		// Execute our actual job before anything else, cache will probably be wiped out by the time we're back.
-		(*entry)(owner, data);
+		job(owner);
+
+		auto& tree{ *job.extension->tree };
+		auto& stages{ tree.stages };
 
-		for (size_t iter{ 0 }; iter < jobTree->size(); ++iter)
+		CounterHandle<> previous;
+
+		for (size_t iter{ 0 }; iter < stages.size(); ++iter)
 		{
-			for (auto& nextJob : (*jobTree)[iter].first)
+			// Every stage waits on the one before it, the last one reports to the completion counter.
+			auto counter{ iter + 1 < stages.size() ? MakeCounter() : tree.completion };
+
+			for (auto& nextJob : stages[iter])
 			{
-				if (iter > 0)
+				if (previous)
 				{
-					nextJob.AddDependency((*jobTree)[iter - 1].second);
+					nextJob.AddDependency(previous);
 				}
 
-				owner->Enqueue(std::move(nextJob), (*jobTree)[iter].second);  // Increments the counter prior to the depending jobs' enqueue.
+				owner->Enqueue(std::move(nextJob), counter);  // Arrives on the counter prior to the depending jobs' enqueue.
 			}
-		}
 
-		auto lockedCounter{ std::prev(jobTree->end())->second };  // We hold the heap resource keeping this counter alive, it will persist until the cleanup job runs.
-		lockedCounter->operator--();  // We queued up the jobs so the counter is guaranteed to be ready.
-
-		auto cleanupJob{ Job{ [](auto, auto payload)
-		{
-			delete reinterpret_cast<TreeType*>(payload);
-		}, static_cast<void*>(jobTree) } };
-		cleanupJob.AddDependency(lockedCounter, 0);
+			previous = std::move(counter);
+		}
 
-		owner->Enqueue(std::move(cleanupJob));  // This trailing job will cleanup the heap resources allocated from the job builder after every job has ran.
+		// Every stage is queued, so the completion counter already covers the final one. The jobs hold on to their own counters,
+		// the tree is released along with us.
+		tree.completion->operator--();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,198 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#include <Jobs/JobHandle.h>
+
+#include <Jobs/Assert.h>
+#include <Jobs/ParkingLot.h>
+
+namespace Jobs
+{
+	namespace Detail
+	{
+		JobSlots::~JobSlots()
+		{
+			const auto count{ blockCount.load(std::memory_order_acquire) };
+
+			for (size_t iter{ 0 }; iter < count; ++iter)
+			{
+				delete[] blocks[iter].load(std::memory_order_relaxed);
+			}
+		}
+
+		void JobSlots::Release(Counter<>* counter)
+		{
+			auto& slot{ static_cast<JobSlot&>(*counter) };
+
+			JOBS_ASSERT(slot.internalValue.load(std::memory_order_relaxed) == 0, "Released a job slot with a pending job.");
+
+			// Anyone still holding a handle to this generation now sees the job as done, waiters already were woken by the departure.
+			slot.generation.fetch_add(1, std::memory_order_seq_cst);
+
+			slot.owner->Push(slot);
+		}
+
+		void JobSlots::Push(JobSlot& slot)
+		{
+			auto head{ freeHead.load(std::memory_order_relaxed) };
+
+			do
+			{
+				slot.nextFree.store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+			}
+
+			while (!freeHead.compare_exchange_weak(head, (((head >> 32) + 1) << 32) | (slot.index + 1), std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		JobSlot* JobSlots::Pop()
+		{
+			auto head{ freeHead.load(std::memory_order_acquire) };
+
+			while (static_cast<std::uint32_t>(head) != 0)
+			{
+				// Slots never move, so reading the next index of a slot someone else just popped is harmless. The tag fails our exchange.
+				auto& slot{ Get(static_cast<std::uint32_t>(head) - 1) };
+				const auto next{ slot.nextFree.load(std::memory_order_relaxed) };
+
+				if (freeHead.compare_exchange_weak(head, (((head >> 32) + 1) << 32) | next, std::memory_order_acquire, std::memory_order_acquire))
+				{
+					return &slot;
+				}
+			}
+
+			return nullptr;
+		}
+
+		void JobSlots::Grow()
+		{
+			growLock.Lock();
+
+			// Someone else might have grown while we were waiting on the lock.
+			if (static_cast<std::uint32_t>(freeHead.load(std::memory_order_acquire)) == 0)
+			{
+				const auto block{ blockCount.load(std::memory_order_relaxed) };
+
+				JOBS_VERIFY(block < maxBlocks, "Exceeded the maximum amount of tracked jobs.");
+
+				auto* newSlots{ new JobSlot[blockSize] };
+
+				for (size_t iter{ 0 }; iter < blockSize; ++iter)
+				{
+					newSlots[iter].owner = this;
+					newSlots[iter].index = static_cast<std::uint32_t>(block * blockSize + iter);
+					newSlots[iter].release = &JobSlots::Release;
+				}
+
+				blocks[block].store(newSlots, std::memory_order_release);
+				blockCount.store(block + 1, std::memory_order_release);
+
+				// Pushed in reverse so that the block is handed out front to back.
+				for (size_t iter{ blockSize }; iter > 0; --iter)
+				{
+					Push(newSlots[iter - 1]);
+				}
+			}
+
+			growLock.Unlock();
+		}
+
+		JobSlot& JobSlots::Acquire()
+		{
+			while (true)
+			{
+				if (auto* slot{ Pop() })
+				{
+					return *slot;
+				}
+
+				Grow();
+			}
+		}
+
+		CounterHandle<> JobSlots::Retain(std::uint32_t index, std::uint32_t generation)
+		{
+			auto& slot{ Get(index) };
+
+			// A slot nobody references is free, taking a reference would bring it back to life under our feet.
+			auto references{ slot.references.load(std::memory_order_relaxed) };
+
+			do
+			{
+				if (references == 0)
+				{
+					return {};
+				}
+			}
+
+			while (!slot.references.compare_exchange_weak(references, references + 1, std::memory_order_acquire, std::memory_order_relaxed));
+
+			CounterHandle<> result{ static_cast<Counter<>&>(slot) };
+			slot.references.fetch_sub(1, std::memory_order_relaxed);  // The handle holds its own reference now.
+
+			// Reused by a newer job, ours is done. Dropping the handle might release the newer one, which is just as well.
+			if (slot.generation.load(std::memory_order_acquire) != generation)
+			{
+				return {};
+			}
+
+			return result;
+		}
+
+		bool JobSlots::IsDone(std::uint32_t index, std::uint32_t generation) const
+		{
+			const auto& slot{ Get(index) };
+
+			if (slot.generation.load(std::memory_order_seq_cst) != generation)
+			{
+				return true;
+			}
+
+			// Sequentially consistent to pair with the waiter registration, see Counter::Evaluate().
+			if (slot.internalValue.load(std::memory_order_seq_cst) == 0)
+			{
+				return true;
+			}
+
+			// A slot is only reused after the generation moved on, so if it hasn't the count we just read was still ours.
+			return slot.generation.load(std::memory_order_seq_cst) != generation;
+		}
+
+		bool JobSlots::ShouldPark(const void* context, std::uintptr_t generation)
+		{
+			const auto& slot{ *static_cast<const JobSlot*>(context) };
+
+			return !slot.owner->IsDone(slot.index, static_cast<std::uint32_t>(generation));
+		}
+
+		void JobSlots::Wait(std::uint32_t index, std::uint32_t generation)
+		{
+			if (IsDone(index, generation))
+			{
+				return;
+			}
+
+			// Wait on the counter rather than the generation, so that dependents holding on to the slot don't hold us up.
+			auto& slot{ Get(index) };
+			slot.RegisterWaiter(0);
+
+			while (!IsDone(index, generation))
+			{
+				ParkingLot::Park(&slot.internalValue, &JobSlots::ShouldPark, &slot, generation);
+			}
+
+			slot.UnregisterWaiter();
+		}
+	}
+
+	bool JobHandle::IsDone() const
+	{
+		return !slots || slots->IsDone(GetIndex(), GetGeneration());
+	}
+
+	void JobHandle::Wait() const
+	{
+		if (slots)
+		{
+			slots->Wait(GetIndex(), GetGeneration());
+		}
+	}
+}
\ No newline at end of file
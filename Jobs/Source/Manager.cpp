@@ -2,14 +2,32 @@
 
 #include <Jobs/Manager.h>
 
-#include <Jobs/FiberMutex.h>
 #include <Jobs/Assert.h>
 #include <Jobs/Logging.h>
+#include <Jobs/ParkingLot.h>
 
 #include <chrono>  // std::chrono
+#include <utility>  // std::exchange
 
 namespace Jobs
 {
+	namespace
+	{
+		struct WorkerRegistration
+		{
+			Manager* owner = nullptr;
+			size_t id = 0;
+		};
+
+		thread_local WorkerRegistration workerRegistration;
+
+		// Never inline, fibers migrate between threads so the address of the thread local must not be cached across a suspension.
+		JOBS_NOINLINE WorkerRegistration& GetWorkerRegistration()
+		{
+			return workerRegistration;
+		}
+	}
+
 	void ManagerWorkerEntry(void* data)
 	{
 		auto* owner = reinterpret_cast<Manager*>(data);
@@ -22,11 +40,22 @@ namespace Jobs
 			std::this_thread::yield();
 		}
 
+		// Register ourselves so that GetThisThreadID() doesn't need to search the workers.
+		for (auto& worker : owner->workers)
+		{
+			if (worker.GetNativeID() == std::this_thread::get_id())
+			{
+				GetWorkerRegistration() = { owner, worker.GetID() };
+
+				break;
+			}
+		}
+
 		auto& representation{ owner->workers[owner->GetThisThreadID()] };
 
 		// We don't have a fiber at this point, so grab an available fiber.
 		auto nextFiberIndex{ owner->GetAvailableFiber() };
-		JOBS_ASSERT(owner->IsValidID(nextFiberIndex), "Failed to retrieve an available fiber from worker.");
+		JOBS_VERIFY(owner->IsValidID(nextFiberIndex), "Failed to retrieve an available fiber from worker.");
 
 		auto& nextFiber = owner->fibers[nextFiberIndex];
 		representation.fiberIndex = nextFiberIndex;  // Update the fiber index.
@@ -49,29 +78,12 @@ namespace Jobs
 
 			// Cleanup any unfinished state from the previous fiber if we need to.
 			auto& thisFiber{ owner->fibers[owner->workers[thisThreadID].fiberIndex] };
-			auto previousFiberIndex{ thisFiber.first.previousFiberIndex };
-			if (owner->IsValidID(previousFiberIndex))
-			{
-				thisFiber.first.previousFiberIndex = Manager::invalidID;  // Reset.
-				auto& previousFiber{ owner->fibers[previousFiberIndex] };
-
-				// Next make sure we restore availability to the fiber that scheduled us or enqueue it in the wait pool.
-				if (previousFiber.first.needsWaitEnqueue)
-				{
-					previousFiber.first.needsWaitEnqueue = false;  // Reset.
-					owner->waitingFibers.enqueue(previousFiberIndex);
-				}
-
-				else
-				{
-					previousFiber.second.store(true);  // #TODO: Memory order.
-				}
-			}
+			owner->CleanupPreviousFiber(thisFiber.first, thisThreadID);
 
 			auto& thisThread{ owner->workers[thisThreadID] };
 			thisFiber.first.waitPoolPriority = !thisFiber.first.waitPoolPriority;  // Alternate wait pool priority.
 
-			bool shouldContinue = !thisFiber.first.waitPoolPriority || owner->waitingFibers.size_approx() == 0;  // Used to favor jobs or waiters.
+			bool shouldContinue = !thisFiber.first.waitPoolPriority || !owner->HasWaitingFibers(thisThreadID);  // Used to favor jobs or waiters.
 
 			if (shouldContinue)
 			{
@@ -86,46 +98,21 @@ namespace Jobs
 					{
 						requiresEvaluation = false;
 
-						for (const auto& dependency : newJob->dependencies)
+						if (!newJob->extension)
 						{
-							if (auto strongDependency{ dependency.first.lock() }; !strongDependency->UnsafeWait(dependency.second, std::chrono::milliseconds{ 1 }))
-							{
-								// This dependency timed out, move ourselves to the wait pool.
-								JOBS_LOG(LogLevel::Log, "Job dependencies timed out, moving to the wait pool.");
-
-								auto nextFiberIndex{ owner->GetAvailableFiber() };
-								JOBS_ASSERT(owner->IsValidID(nextFiberIndex), "Failed to retrieve an available fiber from waiting fiber.");
-								auto& nextFiber = owner->fibers[nextFiberIndex].first;
-
-								auto& thisNewThread = owner->workers[owner->GetThisThreadID()];  // We might resume on any worker, so we need to update this each iteration.
-
-								thisFiber.first.needsWaitEnqueue = true;  // We are waiting on a dependency, so make sure we get added to the wait pool.
-								nextFiber.previousFiberIndex = thisNewThread.fiberIndex;
-								thisNewThread.fiberIndex = nextFiberIndex;  // Update the fiber index.
-								nextFiber.Schedule(thisFiber.first);
-
-								JOBS_LOG(LogLevel::Log, "Job resumed from wait pool, re-evaluating dependencies.");
-
-								// We just returned from a fiber, so we need to make sure to fix up its state. We can't wait until the main loop begins again
-								// because if any of the dependencies still hold, we lose that information about the previous fiber, causing a leak.
+							break;
+						}
 
-								previousFiberIndex = thisFiber.first.previousFiberIndex;
-								if (owner->IsValidID(previousFiberIndex))
-								{
-									thisFiber.first.previousFiberIndex = Manager::invalidID;  // Reset. Skipping this will cause a double-cleanup on the next loop beginning if the dependency doesn't hold.
-									auto& previousFiber{ owner->fibers[previousFiberIndex] };
+						for (const auto& dependency : newJob->extension->dependencies)
+						{
+							if (!dependency.first->Evaluate(dependency.second))
+							{
+								// Park on the dependency, it wakes us once it's satisfied.
+								JOBS_LOG(LogLevel::Log, "Job dependencies unsatisfied, parking.");
 
-									if (previousFiber.first.needsWaitEnqueue)
-									{
-										previousFiber.first.needsWaitEnqueue = false;  // Reset.
-										owner->waitingFibers.enqueue(previousFiberIndex);
-									}
+								dependency.first->Wait(dependency.second);
 
-									else
-									{
-										previousFiber.second.store(true);  // #TODO: Memory order.
-									}
-								}
+								JOBS_LOG(LogLevel::Log, "Job resumed, re-evaluating dependencies.");
 
 								// Next we can re-evaluate the dependencies.
 								requiresEvaluation = true;
@@ -133,20 +120,28 @@ namespace Jobs
 						}
 					}
 
+					thisFiber.first.pinned = newJob->pinned;  // Dependencies are satisfied and we're about to start, from here on we may be bound to this worker.
+
 					if (newJob->stream) [[unlikely]]
 					{
-						(*newJob)(owner);
+						JobBuilder::Execute(*newJob, owner);
 					}
 
 					else
 					{
-						(static_cast<Job>(*newJob))(owner);  // Slice.
+						(*newJob)(owner);
 					}
 
-					// Finished, notify the counter if we have one. Handles expired counters (cleanup jobs) fine.
-					if (auto strongCounter{ newJob->atomicCounter.lock() })
+					thisFiber.first.pinned = false;
+
+					// Finished. Destroy the job before notifying the counter, whoever waits on it may rely on the callable being gone.
+					const auto counter{ std::move(newJob->counter) };
+					const auto counterShard{ newJob->counterShard };
+					newJob.reset();
+
+					if (counter)
 					{
-						strongCounter->operator--();
+						counter->Depart(counterShard);
 					}
 				}
 			}
@@ -154,32 +149,17 @@ namespace Jobs
 			if (shouldContinue)
 			{
 				size_t waitingFiberIndex = Manager::invalidID;
-				if (owner->waitingFibers.try_dequeue(waitingFiberIndex))
+				if (owner->DequeueWaitingFiber(thisThreadID, waitingFiberIndex))
 				{
 					auto& waitingFiber{ owner->fibers[waitingFiberIndex].first };
 
 					JOBS_ASSERT(!thisFiber.first.needsWaitEnqueue, "Logic error, should never request an enqueue if we pulled down a fiber through a dequeue.");
 
-					// Before we schedule the waiting fiber, we need to check if it's waiting on a mutex.
-					if (waitingFiber.mutex && !waitingFiber.mutex->try_lock())
-					{
-						JOBS_LOG(LogLevel::Log, "Waiting fiber failed to acquire mutex.");
-
-						// Move the waiting fiber to the back of the wait queue. We don't need to mark either fiber as needing a wait enqueue
-						// since we never left this fiber.
-						owner->waitingFibers.enqueue(waitingFiberIndex);
+					shouldContinue = false;  // Satisfied, don't continue.
 
-						// Fall through and continue on this fiber.
-					}
-
-					else
-					{
-						shouldContinue = false;  // Satisfied, don't continue.
-
-						waitingFiber.previousFiberIndex = thisThread.fiberIndex;
-						thisThread.fiberIndex = waitingFiberIndex;
-						waitingFiber.Schedule(thisFiber.first);  // Schedule the waiting fiber. We're not a waiter, so we'll be marked as available.
-					}
+					waitingFiber.previousFiberIndex = thisThread.fiberIndex;
+					thisThread.fiberIndex = waitingFiberIndex;
+					waitingFiber.Schedule(thisFiber.first);  // Schedule the waiting fiber. We're not a waiter, so we'll be marked as available.
 				}
 			}
 
@@ -187,18 +167,13 @@ namespace Jobs
 			{
 				JOBS_LOG(LogLevel::Log, "Fiber sleeping.");
 
-				owner->queueCV.Lock();
-
-				// Test the shutdown condition once more under lock, as it could've been set during the transitional period.
-				if (!owner->CanContinue())
-				{
-					owner->queueCV.Unlock();
-
-					break;
-				}
+				owner->TryTrimFibers();  // We're out of work, so this is a cheap point to give back memory from long idle fibers.
 
-				owner->queueCV.Wait();  // We will be woken up either by a shutdown event or if new work is available.
-				owner->queueCV.Unlock();
+				// Block the worker, not just this fiber. We will be woken up either by a shutdown event or if new work is available.
+				// Parking re-checks for work and the shutdown condition, so nothing published during the transitional period slips by.
+				owner->sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+				ParkingLot::ParkThread(&owner->sleepingWorkers, &Manager::ShouldSleep, owner, thisThreadID);
+				owner->sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
 			}
 		}
 
@@ -212,11 +187,9 @@ namespace Jobs
 
 	Manager::~Manager()
 	{
-		queueCV.Lock();  // This is used to make sure we don't let any fibers slip by and not catch the shutdown notify, which causes a deadlock.
 		shutdown.store(true, std::memory_order_seq_cst);
 
-		queueCV.NotifyAll();  // Wake all sleepers, it's time to shutdown.
-		queueCV.Unlock();
+		WakeWorkers(std::numeric_limits<size_t>::max());  // Wake all sleepers, it's time to shutdown. Parking validates against the flag, so nobody slips by.
 
 		// Wait for all of the workers to die before deleting the fiber data.
 		for (auto& worker : workers)
@@ -229,9 +202,15 @@ namespace Jobs
 	{
 		JOBS_ASSERT(threadCount <= std::thread::hardware_concurrency(), "Job manager thread count should not exceed hardware concurrency.");
 
+		fibers = std::vector<std::pair<Fiber, std::atomic_bool>>(fiberCount);  // Constructs in place, the availability flags can't be moved.
+
 		for (auto iter = 0; iter < fiberCount; ++iter)
 		{
+#if JOBS_COPY_STACK_FIBERS
+			fibers[iter].first = std::move(Fiber{ &ManagerFiberEntry, this });
+#else
 			fibers[iter].first = std::move(Fiber{ fiberStackSize, &ManagerFiberEntry, this });
+#endif
 			fibers[iter].second.store(true);  // #TODO: Memory order.
 		}
 
@@ -242,6 +221,8 @@ namespace Jobs
 
 		workers.reserve(threadCount);
 
+		frameArenas.resize(threadCount + 1);  // Before the workers start, they may allocate as soon as they run.
+
 		for (size_t iter = 0; iter < threadCount; ++iter)
 		{
 			workers.emplace_back(this, iter, &ManagerWorkerEntry);
@@ -251,9 +232,9 @@ namespace Jobs
 		ready.store(true, std::memory_order_release);  // This must be set last.
 	}
 
-	std::optional<JobBuilder> Manager::Dequeue(size_t threadID)
+	std::optional<Job> Manager::Dequeue(size_t threadID)
 	{
-		JobBuilder result{};
+		Job result{};
 
 		if (workers[threadID].GetJobQueue().try_dequeue(result))
 		{
@@ -279,26 +260,49 @@ namespace Jobs
 
 	size_t Manager::GetThisThreadID() const
 	{
-		auto thisID{ std::this_thread::get_id() };
+		const auto& registration{ GetWorkerRegistration() };
 
-		for (auto& worker : workers)
+		return registration.owner == this ? registration.id : invalidID;
+	}
+
+	Manager* Manager::GetThisManager()
+	{
+		return GetWorkerRegistration().owner;
+	}
+
+	std::pmr::memory_resource* Detail::GetCurrentMemoryResource()
+	{
+		if (const auto* manager{ Manager::GetThisManager() })
 		{
-			if (worker.GetNativeID() == thisID)
-			{
-				return worker.GetID();
-			}
+			return manager->GetMemoryResource();
 		}
 
-		return invalidID;
+		return std::pmr::get_default_resource();
 	}
 
 	size_t Manager::GetAvailableFiber()
 	{
 		for (auto index = 0; index < fibers.size(); ++index)
 		{
+			// Test before exchanging, skipping over fibers in use shouldn't take ownership of their cache lines.
+			if (!fibers[index].second.load(std::memory_order_relaxed))
+			{
+				continue;
+			}
+
 			auto expected{ true };
-			if (fibers[index].second.compare_exchange_weak(expected, false, std::memory_order_acquire))
+			if (fibers[index].second.compare_exchange_weak(expected, false, std::memory_order_seq_cst))
 			{
+				// A trim might have seen the fiber as available just before we claimed it, let it finish with the stack first.
+				while (fibers[index].first.trimming.load(std::memory_order_seq_cst))
+				{
+					JOBS_CPU_RELAX();
+				}
+
+#if JOBS_COPY_STACK_FIBERS
+				fibers[index].first.Bind(workers[GetThisThreadID()].GetSharedStack());  // The caller is about to schedule it on this worker.
+#endif
+
 				return index;
 			}
 		}
@@ -307,4 +311,299 @@ namespace Jobs
 
 		return invalidID;
 	}
+
+	void Manager::EnqueueWaitingFiber(size_t fiberIndex, size_t threadID)
+	{
+		auto& fiber{ fibers[fiberIndex].first };
+		auto& worker{ workers[threadID] };
+
+		fiber.homeWorker = threadID;
+
+		// Copy-stack fibers can only be resumed on the shared stack they suspended on, which belongs to this worker.
+		if (fiber.pinned || fiber.IsCopyStack())
+		{
+			worker.GetPinnedFiberQueue().enqueue(fiberIndex);
+		}
+
+		else
+		{
+			worker.GetReadyFiberQueue().enqueue(fiberIndex);
+		}
+	}
+
+	bool Manager::DequeueWaitingFiber(size_t threadID, size_t& fiberIndex)
+	{
+		auto& worker{ workers[threadID] };
+
+		// Pinned fibers can only ever be resumed by us, so they get first pick.
+		if (worker.GetPinnedFiberQueue().try_dequeue(fiberIndex) || worker.GetReadyFiberQueue().try_dequeue(fiberIndex))
+		{
+			return true;
+		}
+
+		// We have no waiters of our own, steal from the other workers. They're busy, otherwise they would've resumed their own waiters.
+		for (size_t iter = 1; iter < workers.size(); ++iter)
+		{
+			if (workers[(iter + threadID) % workers.size()].GetReadyFiberQueue().try_dequeue(fiberIndex))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool Manager::HasWaitingFibers(size_t threadID)
+	{
+		auto& worker{ workers[threadID] };
+
+		return worker.GetPinnedFiberQueue().size_approx() > 0 || worker.GetReadyFiberQueue().size_approx() > 0;
+	}
+
+	void Manager::ReleaseFiber(size_t index)
+	{
+		auto& fiber{ fibers[index] };
+
+		fiber.first.idleSince = std::chrono::steady_clock::now();
+		fiber.first.decommitted = false;  // We just ran, so the stack is dirty again.
+
+		if (fiber.first.IsCopyStack())
+		{
+			// Available fibers are parked at the top of the fiber loop, so starting over from the entry point is equivalent to resuming.
+			// This frees the saved frames and lets any worker pick the fiber up.
+			fiber.first.Reset();
+		}
+		fiber.second.store(true, std::memory_order_release);
+	}
+
+	void Manager::CleanupPreviousFiber(Fiber& fiber, size_t threadID)
+	{
+		const auto previousFiberIndex{ fiber.previousFiberIndex };
+		if (IsValidID(previousFiberIndex))
+		{
+			fiber.previousFiberIndex = invalidID;  // Reset. Skipping this will cause a double-cleanup if we suspend again before the fiber loop comes around.
+			auto& previousFiber{ fibers[previousFiberIndex].first };
+
+			// The previous fiber parked. It's fully switched out now, so it's safe to hand it over to whoever will unpark it.
+			if (previousFiber.parkPublish)
+			{
+				const auto publish{ std::exchange(previousFiber.parkPublish, nullptr) };  // Reset.
+				previousFiber.homeWorker = threadID;  // The previous fiber parked on this worker.
+				previousFiber.waiter.fiberIndex = previousFiberIndex;
+
+				if (!publish(previousFiber.parkContext, previousFiber.waiter))
+				{
+					EnqueueWaitingFiber(previousFiberIndex, threadID);  // Nothing to wait for anymore.
+				}
+			}
+
+			// Make sure we restore availability to the fiber that scheduled us or enqueue it in the wait pool.
+			else if (previousFiber.needsWaitEnqueue)
+			{
+				previousFiber.needsWaitEnqueue = false;  // Reset.
+				EnqueueWaitingFiber(previousFiberIndex, threadID);  // The previous fiber suspended on this worker.
+			}
+
+			else
+			{
+				ReleaseFiber(previousFiberIndex);
+			}
+		}
+	}
+
+	void Manager::Suspend()
+	{
+		fibers[workers[GetThisThreadID()].fiberIndex].first.needsWaitEnqueue = true;  // Make sure we get added to the wait pool.
+
+		SwitchToAvailableFiber();
+	}
+
+	void Manager::Park(bool (*publish)(void*, FiberWaiter&), void* context)
+	{
+		JOBS_ASSERT(publish, "Parking requires a publish function.");
+
+		auto& thisFiber{ fibers[workers[GetThisThreadID()].fiberIndex].first };
+		thisFiber.parkPublish = publish;
+		thisFiber.parkContext = context;
+
+		SwitchToAvailableFiber();
+	}
+
+	void Manager::Unpark(FiberWaiter& waiter)
+	{
+		const auto fiberIndex{ waiter.fiberIndex };
+		auto& fiber{ fibers[fiberIndex].first };
+
+		EnqueueWaitingFiber(fiberIndex, fiber.homeWorker);
+
+		// Workers only sleep when they have nothing to resume, so make sure someone picks us up. Only our home worker can resume a pinned fiber.
+		WakeWorkers(fiber.pinned || fiber.IsCopyStack() ? std::numeric_limits<size_t>::max() : 1);
+	}
+
+	void Manager::SwitchToAvailableFiber()
+	{
+		auto& thisThread{ workers[GetThisThreadID()] };
+		const auto thisFiberIndex{ thisThread.fiberIndex };
+		auto& thisFiber{ fibers[thisFiberIndex].first };
+
+		const auto nextFiberIndex{ GetAvailableFiber() };
+		JOBS_VERIFY(IsValidID(nextFiberIndex), "Failed to retrieve an available fiber for a suspension.");
+		auto& nextFiber{ fibers[nextFiberIndex].first };
+
+		nextFiber.previousFiberIndex = thisFiberIndex;
+		thisThread.fiberIndex = nextFiberIndex;  // Update the fiber index.
+		nextFiber.Schedule(thisFiber);
+
+		// We just returned from a fiber, possibly on another worker, so we need to fix up its state here. The caller might suspend again
+		// before the fiber loop begins again, which would lose the previous fiber, causing a leak.
+		CleanupPreviousFiber(thisFiber, GetThisThreadID());
+	}
+
+	void Manager::WakeWorkers(size_t count)
+	{
+		// Pairs with the fence in ShouldSleep(), either a parking worker finds the work we published, or we find the worker.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (sleepingWorkers.load(std::memory_order_relaxed) == 0) [[likely]]
+		{
+			return;
+		}
+
+		ParkingLot::Unpark(&sleepingWorkers, count);
+	}
+
+	bool Manager::HasWork(size_t threadID)
+	{
+		if (HasWaitingFibers(threadID))
+		{
+			return true;
+		}
+
+		// Anything we could dequeue or steal.
+		for (size_t iter = 0; iter < workers.size(); ++iter)
+		{
+			auto& worker{ workers[(iter + threadID) % workers.size()] };
+
+			if (worker.GetJobQueue().size_approx() > 0 || worker.GetReadyFiberQueue().size_approx() > 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool Manager::ShouldSleep(const void* manager, std::uintptr_t threadID)
+	{
+		auto* owner{ const_cast<Manager*>(static_cast<const Manager*>(manager)) };
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		return owner->CanContinue() && !owner->HasWork(static_cast<size_t>(threadID));
+	}
+
+	void Manager::Trim()
+	{
+		TrimFibers(std::chrono::steady_clock::duration::zero());
+	}
+
+	void Manager::BeginFrame()
+	{
+		JOBS_ASSERT(!inFrame.load(std::memory_order_relaxed), "Attempted to begin a frame while another is still open.");
+
+		inFrame.store(true, std::memory_order_release);
+	}
+
+	void Manager::EndFrame()
+	{
+		JOBS_SCOPED_STAT("End Frame");
+		JOBS_ASSERT(inFrame.load(std::memory_order_relaxed), "Attempted to end a frame that was never begun.");
+
+		inFrame.store(false, std::memory_order_release);
+
+		auto settled{ true };
+
+		for (auto& arena : frameArenas)
+		{
+			settled &= arena.Reset();
+		}
+
+		JOBS_ASSERT(settled, "Frame ended with pending work on a frame counter.");
+		(void)settled;
+	}
+
+	void* Manager::AllocateFrame(size_t size, size_t alignment)
+	{
+		JOBS_ASSERT(inFrame.load(std::memory_order_acquire), "Frame allocations are only valid between BeginFrame() and EndFrame().");
+
+		const auto thisThreadID{ GetThisThreadID() };
+
+		if (IsValidID(thisThreadID))
+		{
+			return frameArenas[thisThreadID].Allocate(size, alignment);
+		}
+
+		externalFrameLock.Lock();
+		auto* result{ frameArenas.back().Allocate(size, alignment) };
+		externalFrameLock.Unlock();
+
+		return result;
+	}
+
+	CounterHandle<> Manager::MakeFrameCounter(Counter<>::Type initialValue)
+	{
+		JOBS_ASSERT(inFrame.load(std::memory_order_acquire), "Frame allocations are only valid between BeginFrame() and EndFrame().");
+
+		const auto thisThreadID{ GetThisThreadID() };
+
+		if (IsValidID(thisThreadID))
+		{
+			return frameArenas[thisThreadID].MakeCounter(initialValue);
+		}
+
+		externalFrameLock.Lock();
+		auto result{ frameArenas.back().MakeCounter(initialValue) };
+		externalFrameLock.Unlock();
+
+		return result;
+	}
+
+	void Manager::TrimFibers(std::chrono::steady_clock::duration threshold)
+	{
+		JOBS_SCOPED_STAT("Trim Fibers");
+
+		const auto now{ std::chrono::steady_clock::now() };
+
+		for (auto& fiber : fibers)
+		{
+			// Flag ourselves before checking availability. Whoever claims the fiber in the meantime waits for us to finish with the pages,
+			// so the fiber stays available to the scheduler the whole time.
+			fiber.first.trimming.store(true, std::memory_order_seq_cst);
+
+			if (fiber.second.load(std::memory_order_seq_cst) && !fiber.first.decommitted && now - fiber.first.idleSince >= threshold)
+			{
+				fiber.first.Decommit();
+				fiber.first.decommitted = true;
+			}
+
+			fiber.first.trimming.store(false, std::memory_order_release);
+		}
+	}
+
+	void Manager::TryTrimFibers()
+	{
+		const auto now{ std::chrono::steady_clock::now().time_since_epoch().count() };
+		auto last{ lastTrimTime.load(std::memory_order_relaxed) };
+
+		if (now - last < std::chrono::duration_cast<std::chrono::steady_clock::duration>(fiberTrimInterval).count())
+		{
+			return;
+		}
+
+		// Only one worker needs to perform the trim.
+		if (lastTrimTime.compare_exchange_strong(last, now, std::memory_order_relaxed))
+		{
+			TrimFibers(fiberTrimThreshold);
+		}
+	}
 }
\ No newline at end of file
@@ -0,0 +1,305 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#include <Jobs/ParkingLot.h>
+
+#include <Jobs/Manager.h>
+#include <Jobs/Futex.h>
+#include <Jobs/Spinlock.h>
+#include <Jobs/Assert.h>
+#include <Jobs/Profiling.h>
+
+#include <atomic>  // std::atomic
+#include <array>  // std::array
+
+namespace Jobs
+{
+	namespace
+	{
+		// Fixed size, waiters on different addresses sharing a queue only cost each other a longer scan.
+		constexpr size_t bucketBits = 9;
+		constexpr size_t bucketCount = size_t{ 1 } << bucketBits;
+
+		struct alignas(Detail::hardwareDestructiveInterference) Bucket
+		{
+			Spinlock lock;
+			FiberWaiter* head = nullptr;  // FIFO.
+			FiberWaiter* tail = nullptr;
+			std::atomic<size_t> size{ 0 };  // Only changed under the lock, readable without it.
+		};
+
+		std::array<Bucket, bucketCount> buckets;
+
+		Bucket& GetBucket(const void* address)
+		{
+			// Fibonacci hashing, the low bits of an address are mostly alignment.
+			const auto key{ static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(address)) };
+
+			return buckets[static_cast<size_t>((key * 11400714819323198485ull) >> (64 - bucketBits))];
+		}
+
+		// Detaches up to count waiters on the address, in the order they parked. Expects the lock to be held.
+		FiberWaiter* Detach(Bucket& bucket, const void* address, size_t count, bool& mayHaveMore)
+		{
+			FiberWaiter* detached{ nullptr };
+			FiberWaiter* detachedTail{ nullptr };
+			FiberWaiter* previous{ nullptr };
+
+			mayHaveMore = false;
+
+			for (auto* waiter{ bucket.head }; waiter;)
+			{
+				auto* next{ waiter->next.load(std::memory_order_relaxed) };
+
+				if (waiter->address != address)
+				{
+					previous = waiter;
+					waiter = next;
+
+					continue;
+				}
+
+				if (count == 0)
+				{
+					mayHaveMore = true;
+
+					break;
+				}
+
+				// Unlink.
+				if (previous)
+				{
+					previous->next.store(next, std::memory_order_relaxed);
+				}
+
+				else
+				{
+					bucket.head = next;
+				}
+
+				if (bucket.tail == waiter)
+				{
+					bucket.tail = previous;
+				}
+
+				waiter->next.store(nullptr, std::memory_order_relaxed);
+
+				if (detachedTail)
+				{
+					detachedTail->next.store(waiter, std::memory_order_relaxed);
+				}
+
+				else
+				{
+					detached = waiter;
+				}
+
+				detachedTail = waiter;
+
+				bucket.size.fetch_sub(1, std::memory_order_relaxed);
+				--count;
+
+				waiter = next;
+			}
+
+			return detached;
+		}
+	}
+
+	ParkingLot::ParkResult ParkingLot::Park(const void* address, ValidateType validate, const void* context, std::uintptr_t value)
+	{
+		JOBS_SCOPED_STAT("Parking Lot Park");
+
+		auto* manager{ Manager::GetThisManager() };
+
+		// Outside of the workers, block the thread.
+		if (!manager)
+		{
+			return ParkThread(address, validate, context, value);
+		}
+
+		// Inside of a job, park the fiber. The waiter node lives in the fiber, we can't take the address of anything on our stack.
+		auto& waiter{ Fiber::GetCurrent()->waiter };
+		waiter.owner = manager;
+		waiter.address = address;
+		waiter.validate = validate;
+		waiter.context = context;
+		waiter.value = value;
+		waiter.signaled.store(0, std::memory_order_relaxed);
+
+		manager->Park(&ParkingLot::Publish, nullptr);
+
+		// Either woken, or resumed straight away because the validation failed once we were switched out.
+		auto& resumedWaiter{ Fiber::GetCurrent()->waiter };
+
+		if (resumedWaiter.signaled.load(std::memory_order_acquire) == 0)
+		{
+			return {};
+		}
+
+		return { true, resumedWaiter.value };
+	}
+
+	ParkingLot::ParkResult ParkingLot::ParkThread(const void* address, ValidateType validate, const void* context, std::uintptr_t value)
+	{
+		FiberWaiter waiter;
+		waiter.address = address;
+		waiter.validate = validate;
+		waiter.context = context;
+		waiter.value = value;
+
+		if (!Enqueue(waiter))
+		{
+			return {};
+		}
+
+		return Block(waiter);
+	}
+
+	bool ParkingLot::ParkAsync(FiberWaiter& waiter)
+	{
+		JOBS_ASSERT(waiter.resume, "Asynchronous waiters require a resume callback.");
+
+		waiter.owner = nullptr;
+		waiter.signaled.store(0, std::memory_order_relaxed);
+
+		return Enqueue(waiter);
+	}
+
+	size_t ParkingLot::Unpark(const void* address, size_t count, std::uintptr_t token)
+	{
+		if (!MayHaveParked(address))
+		{
+			return 0;
+		}
+
+		auto& bucket{ GetBucket(address) };
+		auto mayHaveMore{ false };
+
+		bucket.lock.Lock();
+		auto* woken{ Detach(bucket, address, count, mayHaveMore) };
+		bucket.lock.Unlock();
+
+		size_t result{ 0 };
+
+		// Read the link first, the waiter belongs to its owner again once it's woken.
+		while (woken)
+		{
+			auto* next{ woken->next.load(std::memory_order_relaxed) };
+			Wake(*woken, token);
+			woken = next;
+
+			++result;
+		}
+
+		return result;
+	}
+
+	bool ParkingLot::UnparkOne(const void* address, UnparkCallbackType callback, void* context)
+	{
+		JOBS_ASSERT(callback, "Unparking requires a callback.");
+
+		auto& bucket{ GetBucket(address) };
+		auto mayHaveMore{ false };
+
+		bucket.lock.Lock();
+		auto* woken{ Detach(bucket, address, 1, mayHaveMore) };
+		const auto token{ callback(context, woken != nullptr, mayHaveMore) };
+		bucket.lock.Unlock();
+
+		if (woken)
+		{
+			Wake(*woken, token);
+		}
+
+		return woken != nullptr;
+	}
+
+	bool ParkingLot::MayHaveParked(const void* address)
+	{
+		return GetBucket(address).size.load(std::memory_order_seq_cst) > 0;
+	}
+
+	bool ParkingLot::Publish(void*, FiberWaiter& waiter)
+	{
+		return Enqueue(waiter);
+	}
+
+	bool ParkingLot::Enqueue(FiberWaiter& waiter)
+	{
+		auto& bucket{ GetBucket(waiter.address) };
+
+		bucket.lock.Lock();
+
+		// Register before validating, see MayHaveParked().
+		bucket.size.fetch_add(1, std::memory_order_seq_cst);
+
+		if (!waiter.validate(waiter.context, waiter.value))
+		{
+			bucket.size.fetch_sub(1, std::memory_order_relaxed);
+			bucket.lock.Unlock();
+
+			return false;
+		}
+
+		waiter.next.store(nullptr, std::memory_order_relaxed);
+
+		if (bucket.tail)
+		{
+			bucket.tail->next.store(&waiter, std::memory_order_relaxed);
+		}
+
+		else
+		{
+			bucket.head = &waiter;
+		}
+
+		bucket.tail = &waiter;
+
+		bucket.lock.Unlock();
+
+		return true;
+	}
+
+	void ParkingLot::Wake(FiberWaiter& waiter, std::uintptr_t token)
+	{
+		waiter.value = token;
+
+		// The callback may well destroy the waiter, it's not ours to touch afterwards.
+		if (waiter.resume)
+		{
+			waiter.signaled.store(1, std::memory_order_release);
+			waiter.resume(waiter);
+
+			return;
+		}
+
+		if (auto* manager{ waiter.owner })
+		{
+			waiter.signaled.store(1, std::memory_order_release);
+			manager->Unpark(waiter);
+
+			return;
+		}
+
+		// Threads can return as soon as they see the signal, so the node is gone after the store. Waking a stale address is harmless.
+		Futex futex;
+		futex.Set(&waiter.signaled);
+
+		waiter.signaled.store(1, std::memory_order_release);
+		futex.NotifyOne();
+	}
+
+	ParkingLot::ParkResult ParkingLot::Block(FiberWaiter& waiter)
+	{
+		Futex futex;
+		futex.Set(&waiter.signaled);
+
+		auto expected{ 0u };
+		while (waiter.signaled.load(std::memory_order_acquire) == 0)
+		{
+			futex.Wait(&expected);
+		}
+
+		return { true, waiter.value };
+	}
+}
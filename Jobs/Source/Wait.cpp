@@ -0,0 +1,99 @@
+// Copyright (c) 2019-2021 Andrew Depke
+
+#include <Jobs/Wait.h>
+
+#include <Jobs/Assert.h>
+#include <Jobs/Profiling.h>
+#include <Jobs/ParkingLot.h>
+#include <Jobs/Allocator.h>
+
+#include <limits>  // std::numeric_limits
+#include <new>  // placement new
+
+namespace Jobs
+{
+	namespace Detail
+	{
+		size_t MultiWait::Wait(const CounterHandle<>* counters, size_t count, Counter<>::Type expectedValue, bool any)
+		{
+			JOBS_SCOPED_STAT("Multi Wait");
+			JOBS_ASSERT(count > 0, "Attempted to wait on an empty set of counters.");
+
+			constexpr auto pending{ std::numeric_limits<size_t>::max() };
+
+			size_t first{ 0 };  // Counters before this one are done. Like consecutive waits, a counter only needs to be satisfied once.
+
+			const auto evaluate{ [&]()
+			{
+				if (any)
+				{
+					for (size_t iter{ 0 }; iter < count; ++iter)
+					{
+						if (counters[iter]->Evaluate(expectedValue))
+						{
+							return iter;
+						}
+					}
+
+					return pending;
+				}
+
+				while (first < count && counters[first]->Evaluate(expectedValue))
+				{
+					++first;
+				}
+
+				return first == count ? count : pending;
+			} };
+
+			auto result{ evaluate() };
+			if (result != pending)
+			{
+				return result;
+			}
+
+			// Link a single signal into every counter we're waiting on so that we only block once. Parks the fiber inside of a job.
+			// Counters write to the signal and the parking lot keys on it while we're parked, so like the links it can't live on the
+			// stack, copy-stack fibers hand theirs to other fibers in the meantime.
+			using SignalPool = SizeClassAllocator<MultiWaitSignal>;
+			auto* signal{ new (SignalPool::Allocate()) MultiWaitSignal{} };
+			std::vector<CounterLink> links(count);
+
+			for (size_t iter{ first }; iter < count; ++iter)
+			{
+				links[iter].signal = signal;
+				counters[iter]->Link(links[iter], expectedValue);
+			}
+
+			while (true)
+			{
+				// Capture before evaluating, any signal after this point prevents the sleep.
+				auto epoch{ signal->epoch.load(std::memory_order_seq_cst) };
+
+				if ((result = evaluate()) != pending)
+				{
+					break;
+				}
+
+				ParkingLot::Park(&signal->epoch, [](const void* context, std::uintptr_t value)
+				{
+					return static_cast<const MultiWaitSignal*>(context)->epoch.load(std::memory_order_seq_cst) == value;
+				}, signal, epoch);
+			}
+
+			for (size_t iter{ 0 }; iter < count; ++iter)
+			{
+				if (links[iter].signal)
+				{
+					counters[iter]->Unlink(links[iter]);
+				}
+			}
+
+			// Unlinking synchronizes with the notifiers, none of them can still be touching the signal.
+			signal->~MultiWaitSignal();
+			SignalPool::Free(signal);
+
+			return result;
+		}
+	}
+}
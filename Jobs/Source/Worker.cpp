@@ -27,6 +27,10 @@ namespace Jobs
 		Fiber baseFiber;  // Holds the real thread fiber.
 		threadFiber = new Fiber{ Manager::fiberStackSize, entry, owner };
 
+#if JOBS_COPY_STACK_FIBERS
+		sharedStack = new SharedStack{ Manager::sharedStackSize };
+#endif
+
 		threadHandle = std::thread{ [this, &baseFiber]()
 		{
 			threadFiber->Schedule(baseFiber);  // Schedule our fiber from a new thread. We will never resume.
@@ -62,6 +66,7 @@ namespace Jobs
 		}
 
 		delete threadFiber;
+		delete sharedStack;
 	}
 
 	void Worker::Swap(Worker& other) noexcept
@@ -70,6 +75,9 @@ namespace Jobs
 		std::swap(threadHandle, other.threadHandle);
 		std::swap(id, other.id);
 		std::swap(threadFiber, other.threadFiber);
+		std::swap(sharedStack, other.sharedStack);
 		std::swap(jobQueue, other.jobQueue);
+		std::swap(readyFibers, other.readyFibers);
+		std::swap(pinnedFibers, other.pinnedFibers);
 	}
 }
\ No newline at end of file
@@ -3,6 +3,15 @@
 
 linkbuildoutputs "On"
 
+-- Selects the lean context switch variant of the jump routines, see the lean-context option.
+local masmDefines = ""
+local gasDefines = ""
+
+if EnableLeanContext then
+	masmDefines = " /D JOBS_LEAN_CONTEXT_SWITCH"
+	gasDefines = " -DJOBS_LEAN_CONTEXT_SWITCH"
+end
+
 filter { "system:windows", "architecture:x86_64" }
 	files { "src/asm/jump_x86_64_ms_pe_masm.*", "src/asm/make_x86_64_ms_pe_masm.*" }
 
@@ -11,12 +20,12 @@ filter { "system:linux", "architecture:x86_64" }
 
 filter { "files:**.asm", "system:windows" }
 	buildmessage "Assembling boost.context fiber routine: %{file.name}"
-	buildcommands "ml64.exe /c /Fo %{cfg.objdir}/%{file.basename} /D BOOST_CONTEXT_EXPORT=EXPORT %{file.relpath}"
+	buildcommands ("ml64.exe /c /Fo %{cfg.objdir}/%{file.basename} /D BOOST_CONTEXT_EXPORT=EXPORT" .. masmDefines .. " %{file.relpath}")
 	buildoutputs "%{cfg.objdir}/%{file.basename}.obj"
 
 filter { "files:**.[sS]", "system:linux" }
 	buildmessage "Assembling boost.context fiber routine: %{file.name}"
-	buildcommands "gcc -c %{file.relpath}"
+	buildcommands ("gcc -c" .. gasDefines .. " %{file.relpath}")
 	buildoutputs "%{cfg.objdir}/%{file.basename}.o"
 
 filter {}
\ No newline at end of file
@@ -5,6 +5,7 @@
 ;           http://www.boost.org/LICENSE_1_0.txt)
 
 ; Modified by Andrew Depke to restore the ability to schedule fibers without invalidation.
+; Defining JOBS_LEAN_CONTEXT_SWITCH skips the MXCSR and x87 control word, XMM6-XMM15 are callee-saved and always preserved.
 
 ;  ----------------------------------------------------------------------------------
 ;  |     0   |     1   |     2    |     3   |     4   |     5   |     6   |     7   |
@@ -104,10 +105,12 @@ IFNDEF BOOST_USE_TSX
     movaps  [rsp+070h], xmm13
     movaps  [rsp+080h], xmm14
     movaps  [rsp+090h], xmm15
+IFNDEF JOBS_LEAN_CONTEXT_SWITCH
     ; save MMX control- and status-word
     stmxcsr  [rsp+0a0h]
     ; save x87 control-word
     fnstcw  [rsp+0a4h]
+ENDIF
 ENDIF
 
     ; load NT_TIB
@@ -152,10 +155,12 @@ IFNDEF BOOST_USE_TSX
     movaps  xmm13, [rsp+070h]
     movaps  xmm14, [rsp+080h]
     movaps  xmm15, [rsp+090h]
+IFNDEF JOBS_LEAN_CONTEXT_SWITCH
     ; restore MMX control- and status-word
     ldmxcsr  [rsp+0a0h]
     ; save x87 control-word
     fldcw   [rsp+0a4h]
+ENDIF
 ENDIF
 
     ; load NT_TIB
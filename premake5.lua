@@ -8,8 +8,32 @@ newoption {
 	description = "Enables internal profiling utilities and Tracy zone emission. Also creates Tracy projects and a profiling project from the Examples/ directory."
 }
 
+newoption {
+	trigger = "lean-context",
+	description = "Skips saving and restoring the MXCSR and x87 control words on fiber switches. Only safe if jobs never modify the floating point environment."
+}
+
+newoption {
+	trigger = "copy-stack",
+	description = "Runs fibers on a stack shared per worker, copying out only the used portion on suspension. Allows for far more suspended jobs, at the cost of slower switches. Jobs must not share pointers to their stack across a suspension."
+}
+
+newoption {
+	trigger = "cpp20",
+	description = "Builds everything as C++20, which enables coroutine tasks (Task.h)."
+}
+
+newoption {
+	trigger = "benchmarks",
+	description = "Creates a console project for each benchmark in the Benchmarks/ directory."
+}
+
 EnableLogging = false
 EnableProfiling = false
+EnableLeanContext = false
+EnableCopyStack = false
+EnableCpp20 = false
+EnableBenchmarks = false
 
 if _OPTIONS["logging"] then
 	EnableLogging = true
@@ -19,6 +43,28 @@ if _OPTIONS["profiling"] then
 	EnableProfiling = true
 end
 
+if _OPTIONS["lean-context"] then
+	EnableLeanContext = true
+end
+
+if _OPTIONS["copy-stack"] then
+	EnableCopyStack = true
+end
+
+if _OPTIONS["cpp20"] then
+	EnableCpp20 = true
+end
+
+if _OPTIONS["benchmarks"] then
+	EnableBenchmarks = true
+end
+
+if EnableCpp20 then
+	CppDialect = "C++20"
+else
+	CppDialect = "C++17"
+end
+
 workspace "Jobs"
 	platforms { "Static64" }
 	configurations { "Debug", "Release" }
@@ -65,7 +111,7 @@ workspace "Jobs"
 		
 project "Jobs"
 	language "C++"
-	cppdialect "C++17"
+	cppdialect (CppDialect)
 	kind "StaticLib"
 	
 	location "Build/Generated"
@@ -91,6 +137,18 @@ project "Jobs"
 		defines { "JOBS_ENABLE_PROFILING=0" }
 	end
 	
+	if EnableLeanContext then
+		defines { "JOBS_LEAN_CONTEXT_SWITCH=1" }
+	else
+		defines { "JOBS_LEAN_CONTEXT_SWITCH=0" }
+	end
+	
+	if EnableCopyStack then
+		defines { "JOBS_COPY_STACK_FIBERS=1" }
+	else
+		defines { "JOBS_COPY_STACK_FIBERS=0" }
+	end
+	
 	files { "Jobs/Include/Jobs/*.h", "Jobs/Include/Jobs/*/*.h", "Jobs/Source/*.cpp" }
 	
 	if EnableProfiling then
@@ -119,7 +177,7 @@ project "Jobs"
 if EnableProfiling then
 	project "Profiling"
 		language "C++"
-		cppdialect "C++17"
+		cppdialect (CppDialect)
 		kind "ConsoleApp"
 		
 		location "Build/Generated"
@@ -140,6 +198,12 @@ if EnableProfiling then
 			defines { "JOBS_ENABLE_LOGGING=0" }
 		end
 		
+		if EnableCopyStack then
+			defines { "JOBS_COPY_STACK_FIBERS=1" }
+		else
+			defines { "JOBS_COPY_STACK_FIBERS=0" }
+		end
+		
 		files { "Examples/*.cpp" }
 		
 		libdirs "Build/Bin/*"
@@ -148,4 +212,48 @@ if EnableProfiling then
 		links { "Jobs", "Tracy" }
 		
 		include "tracy"
+end
+	
+if EnableBenchmarks then
+	for _, benchmark in ipairs(os.matchfiles("Benchmarks/*.cpp")) do
+		local benchmarkName = "Benchmark" .. path.getbasename(benchmark)
+		
+		project (benchmarkName)
+			language "C++"
+			cppdialect (CppDialect)
+			kind "ConsoleApp"
+			
+			location "Build/Generated"
+			buildlog ("Build/Logs/" .. benchmarkName .. ".log")
+			basedir "../../"
+			objdir ("Build/Intermediate/%{cfg.platform}_%{cfg.buildcfg}/" .. benchmarkName)
+			targetdir "Build/Bin/%{cfg.platform}_%{cfg.buildcfg}"
+			
+			targetname (benchmarkName)
+			
+			includedirs { "Jobs/Include", "Benchmarks" }
+			
+			defines { "JOBS_ENABLE_LOGGING=0", "JOBS_ENABLE_PROFILING=0" }
+			
+			if EnableLeanContext then
+				defines { "JOBS_LEAN_CONTEXT_SWITCH=1" }
+			else
+				defines { "JOBS_LEAN_CONTEXT_SWITCH=0" }
+			end
+			
+			if EnableCopyStack then
+				defines { "JOBS_COPY_STACK_FIBERS=1" }
+			else
+				defines { "JOBS_COPY_STACK_FIBERS=0" }
+			end
+			
+			files { benchmark, "Benchmarks/*.h" }
+			
+			links { "Jobs" }
+			
+			filter { "system:linux" }
+				links { "pthread" }
+				
+			filter {}
+	end
 end
\ No newline at end of file